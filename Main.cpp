@@ -10,6 +10,7 @@
 #include <math.h>
 #include <time.h>
 #include <string>
+#include <string.h>
 #include <assert.h>
 #include <sys/stat.h>
 
@@ -17,34 +18,210 @@
 //using namespace std;
 
 // g++ -DNDEBG ... to turn off assertions
-// g++ -w Main.cpp lib/*.cpp -DHill -I lib/  i
+// g++ -w -O2 -pthread Main.cpp -DHill -I lib/
 
 static constexpr double PI=M_PI;  // use Pi defined in math.h
 
 
-#include "score.h";
-#include "simulation.h";
+#ifndef _score_h_included_
+#define _score_h_included_
+#include "score.h"
+#endif
+
+#ifndef _simulation_h_included_
+#define _simulation_h_included_
+#include "simulation.h"
+#endif
+
+#ifndef _fit_h_included_
+#define _fit_h_included_
+#include "fit.h"
+#endif
+
+
+// Optional arguments follow the six required ones as name=value pairs, 
+// e.g.  ./a.out 200 2 100 1 0 0 threads=8
+//
+// All the isis of the McGuinness 2010 Fig. 10 panel in one run:
+//       ./a.out 1000,200,100,75,50,25,10 10,2,1,0.75,0.5,0.25,0.1 100 1 0 1
+//
+const char * option(int argc, char* argv[], const char * name)
+{
+   int len = strlen(name);
+   
+   for(int k=7; k < argc; ++k)
+   {
+      if (strncmp(argv[k], name, len) == 0 && argv[k][len] == '=') {
+         return argv[k] + len + 1;
+      }
+   }
+   return 0;
+}
+
+double option(int argc, char* argv[], const char * name, double value)
+{
+   const char * s = option(argc, argv, name);
+   
+   return (s != 0) ? atof(s) : value;
+}
+
+// Comma separated list of numbers, e.g. "1000,200,50".
+//
+std::vector<double> numbers(const char * s)
+{
+   std::vector<double> x;
+   
+   for(const char * p = s; p != 0; p = strchr(p, ','))
+   {
+      if (*p == ',') {
+         ++p;
+      }
+      x.push_back( atof(p) );
+   }
+   return x;
+}
+
+
+// The experiment for one isi and calcium sensor model, with the options from 
+// the command line.  sweep:  several experiments run in this process at the 
+// same time.  out:  directory for its files.
+//
+EX experiment(int argc, char* argv[], double isi, double seconds, double trials, 
+              int AP5, int RyR, int astro, int sweep, int sensor, const char * out)
+{
+   EX ex;
+   
+   double deltaT = option(argc, argv, "dt", REFERENCE_DT);   // ms
+   
+   ex.isi=isi, ex.seconds=seconds, ex.trials=trials, ex.deltaT=deltaT, ex.astro=astro;
+     
+   printf("\n\n =======Sim for isi=%0.0f \n =========", isi);
+   
+   buildTrain(ex);   // builds spike train for experiment ex
+   
+   ex.threads = (int) option(argc, argv, "threads", ex.threads);   // 0: one per core
+   ex.seed    = (int) option(argc, argv, "seed",    ex.seed);
+   ex.replay  = (int) option(argc, argv, "replay",  ex.replay);    // run only this trial
+   ex.sweep   = sweep;
+   ex.sensor  = sensor;
+   ex.out     = out;
+   
+   if (ex.replay > 0) {
+      ex.trials = 1;
+   }
+   
+   // the probes and the ensemble record while the trials run, so the traces
+   // keep only the last few time points unless ring=0 asks for all of them
+   if (option(argc, argv, "ring", 1)) {
+      ex.history = ring_history(ex);
+   }
+   
+   ex.probes = option(argc, argv, "probes");   // traces to save, see probe.h
+   ex.csv    = (int) option(argc, argv, "csv", ex.csv);   // traces as csv files, not csv/trace*.bin
+   ex.batch  = (int) option(argc, argv, "batch", ex.batch); // 0: one trial at a time, see batch.h
+   ex.ff     = (int) option(argc, argv, "ff", ex.ff);    // fast-forward between spikes:  batched Hill trials only
+   ex.tables = (int) option(argc, argv, "tables", ex.tables);   // HH rates, mcinf and Mg block from a table
+   ex.ssa    = (int) option(argc, argv, "ssa", ex.ssa);      // Markov sensors:  exact stochastic simulation
+   ex.cache  = option(argc, argv, "cache");   // directory of the result cache, see cache.h
+   ex.paired = (int) option(argc, argv, "paired", ex.paired);   // common random numbers for both conditions
+   ex.precision  = option(argc, argv, "precision", ex.precision);   // e.g. 0.02:  trials until every bar is +- 0.02
+   ex.min_trials = (int) option(argc, argv, "min_trials", ex.min_trials);
+   ex.ensemble   = option(argc, argv, "ensemble");    // probes averaged over all trials, see ensemble.h
+   ex.quantiles  = option(argc, argv, "quantiles");   // ... and their percentiles
+   ex.hoist  = (int) option(argc, argv, "hoist", ex.hoist);   // the membrane once per experiment, see Drive
+   ex.exact  = (int) option(argc, argv, "exact", ex.exact);   // AP5 bars from exact release probabilities
+   ex.rb     = (int) option(argc, argv, "rb", ex.rb);      // bars from expected, not sampled, releases
+   
+   const char * hazard = option(argc, argv, "hazard");   // releases by inverse hazard, see HazardRelease
+   
+   ex.hazard = (hazard == 0) ? 0 : (strcmp(hazard, "check") == 0) ? HAZARD_CHECK : atoi(hazard);
+   
+   const char * meanfield = option(argc, argv, "meanfield");   // expected releases in one trial, see exact.h
+   
+   ex.meanfield = (meanfield == 0) ? 0 : (strcmp(meanfield, "check") == 0) ? MEANFIELD_CHECK : atoi(meanfield);
+   
+   if (ex.meanfield && (ex.sensor == SENSOR_MARKOV || ex.sensor == SENSOR_MARKOV6)) {   // random states, see exact.h
+      fprintf(stderr, "meanfield:  the %s sensor has no mean field, use sensor=Hill or Allosteric\n", sensor_names[ex.sensor]);
+      exit(1);
+   }
+   
+   const char * integrator = option(argc, argv, "integrator");   // euler, or rl for larger dt
+   
+   for(int k=0; integrator != 0 && k <= INTEGRATORS; ++k)
+   {
+      if (k == INTEGRATORS) {
+         fprintf(stderr, "unknown integrator %s\n", integrator);
+         exit(1);
+      }
+      if (strcmp(integrator, integrator_names[k]) == 0) {
+         ex.integrator = k;
+         break;
+      }
+   }
+   
+   // ex.ssa draws at the jumps, which follow the calcium of the condition:  
+   // the two conditions would use their random numbers for different things
+   if (ex.paired && ex.ssa) 
+   {
+      printf(" paired=1:  ssa=0, the jumps of ssa=1 do not pair \n");
+      ex.ssa = 0;
+   }
+   
+   // ex.ff is a part of the batched kernel of the Hill sensor (see batch.h):
+   // trials run one at a time step through the quiet stretches
+   if (ex.ff && (ex.sensor != SENSOR_HILL || ! ex.batch || ! ensemble_batched(ex))) 
+   {
+      printf(" ff=1:  ff=0, only batched trials of the Hill sensor fast-forward \n");
+      ex.ff = 0;
+   }
+   
+   if(AP5 == 1) 
+   {
+    ex.AP5_exp=1;
+    ex.RY_exp =0;
+    printf(" ==> sim ACSF, AP5: isi=%0.0f \n\n", isi);
+   } 
+   else if (RyR == 1) 
+   {
+    ex.AP5_exp=0;
+    ex.RY_exp = 1;
+    printf(" ==> sim ACSF, RyR: isi=%0.0f \n\n", isi);
+   }
+   return ex;
+}
+
 
 int main(int argc, char* argv[])
 {  
    // struct Ex contains simulation parameters for experiment
-   EX ex, optimal;  // experimental setup
+   std::vector<EX> ex;  // experimental setup, one per isi
    
-   double  isi, seconds, trials;
+   std::vector<double> isi, seconds;
+   double trials;
    int AP5, RyR, astro;
    
-   double * pr_ACSF_barChart; 
-   double * pr_BLOCKER_barChart;
-   
    if (argc < 7) 
    {
-     fprintf(stderr, "Usage: %s  isi seconds trials AP5={0,1} RyR={0,1} astro={0,1}} \n", argv[0]); 
+     fprintf(stderr, "Usage: %s  isi seconds trials AP5={0,1} RyR={0,1} astro={0,1} [threads=N] [seed=N] [replay=trial] [ring={0,1}] [probes=name[:decimation][@window],...] [csv=1] [sensor=Hill|Markov|Markov6|Allosteric] [batch={0,1}] [ff={0,1}] [dt=ms] [integrator=euler|rl] [tables={0,1}] [ssa={0,1}] [fit=nm|cmaes] [fit_params=n1,Kd1,...] [fit_evals=N] [fit_reps=N] [cache=dir] [paired={0,1}] [precision=Pr] [min_trials=N] [ensemble=name[:decimation][@window],...] [quantiles=5,50,95] [hoist={0,1}] [exact={0,1}] [rb={0,1}] [hazard={0,1,check}] [meanfield={0,1,check}] \n", argv[0]); 
+     fprintf(stderr, "       isi and seconds may be lists, e.g. 1000,200,50 10,2,0.5, to sweep the isis in one run\n");
+     fprintf(stderr, "       sensor may be a list too, e.g. sensor=Hill,Allosteric;  each model saves to csv/{sensor}\n");
+     fprintf(stderr, "       integrator=rl takes exponential steps, stable with dt up to a few tenths of a ms\n");
+     fprintf(stderr, "       cache=dir reads an experiment run before, with the same parameters and build, from dir\n");
+     fprintf(stderr, "       paired=1 gives trial n of both conditions the same random numbers, and reports their difference;  not with ssa=1\n");
+     fprintf(stderr, "       precision=0.02 runs trials until every bar is known to +- 0.02 (95%%), at least min_trials, at most trials\n");
+     fprintf(stderr, "       exact=1 computes the bars of AP5 exactly, for the Hill and Allosteric sensors, in one trial\n");
+     fprintf(stderr, "       rb=1 adds up the release probability of each spike given the trial, not its release, for smaller errors\n");
+     fprintf(stderr, "       hazard=1 draws one number per release instead of one per time step;  hazard=check tests that first\n");
+     fprintf(stderr, "       meanfield=1 releases the expected vesicles in one trial, for approximate bars fast;  with fit= only the fit;  not with the Markov sensors\n");
+     fprintf(stderr, "       meanfield=check first prints its deviation from the trials at the isis 1000, 200 and 50\n");
+     fprintf(stderr, "       ensemble= saves the mean and sd over all trials of the probes listed, e.g. ensemble=b_ca_MD:20,b_ca_local,bg\n");
+     fprintf(stderr, "       fit=nm or fit=cmaes first fits fit_params to the data of the isis 1000, 200 and 50, then runs the best\n");
      exit(1);
    }
    else
    {  
-     isi     = atof(argv[1]);
-     seconds = atof(argv[2]);
+     isi     = numbers(argv[1]);
+     seconds = numbers(argv[2]);
      trials  = atof(argv[3]);
      
      AP5  = atoi(argv[4]);  // 0 or 1,  off or on
@@ -52,6 +229,15 @@ int main(int argc, char* argv[])
      astro=atoi(argv[6]);
    } 
    
+   if (seconds.size() == 1) {
+      seconds.resize(isi.size(), seconds[0]);   // same duration for every isi
+   }
+   
+   if (seconds.size() != isi.size()) 
+   {
+     fprintf(stderr, "%d isis but %d durations\n", (int) isi.size(), (int) seconds.size());
+     exit(1);
+   }
 
    // make sure png and csv directories exist
    struct stat sb;  
@@ -68,57 +254,154 @@ int main(int argc, char* argv[])
        mkdir("csv", 0700);
    }
 
+   const char * cache = option(argc, argv, "cache");
    
-   double deltaT=0.05;   // for Euler method
+   if (cache != 0 && stat(cache, &sb) != 0) 
+   {
+       printf("mkdir %s \n", cache);
+       
+       if (mkdir(cache, 0700) != 0) {
+          fprintf(stderr, "cannot create the cache directory %s\n", cache);
+          exit(1);
+       }
+   }
+
+   if (AP5 != 1 && RyR != 1) 
+   {
+    printf("No blocker was specified.\n");
+    return 0;
+   }
    
-   ex.isi=isi, ex.seconds=seconds, ex.trials=trials, ex.deltaT=deltaT, ex.astro=astro;
-     
-   printf("\n\n =======Sim for isi=%0.0f \n =========", isi);
+   // calcium sensor models, by default the one named at compile time
+   std::vector<int> sensors;
    
-   buildTrain(ex);   // builds spike train for experiment ex
+   const char * names = option(argc, argv, "sensor");
+   
+   for(const char * p = names; p != 0; p = strchr(p, ','))
+   {
+      if (*p == ',') {
+         ++p;
+      }
+      int m=0;
+      while (m < SENSORS && ! (strncmp(p, sensor_names[m], strlen(sensor_names[m])) == 0 && 
+                               (p[strlen(sensor_names[m])] == ',' || p[strlen(sensor_names[m])] == 0)) ) {
+         ++m;
+      }
+      if (m == SENSORS) {
+         fprintf(stderr, "unknown sensor %s\n", p);
+         exit(1);
+      }
+      sensors.push_back(m);
+   }
+   
+   if (sensors.empty()) {
+      sensors.push_back(SENSOR_DEFAULT);
+   }
    
-   pr_ACSF_barChart     = init_double(ex.bins); // array of doubles
-   pr_BLOCKER_barChart  = init_double(ex.bins); 
+   static const char * sensor_dirs[SENSORS] = { "csv/Hill", "csv/Markov", "csv/Markov6", "csv/Allosteric" };
    
-   if(AP5 == 1) 
+   int sweep = isi.size() > 1 || sensors.size() > 1;
+   
+   for(size_t m=0; m < sensors.size(); ++m) 
    {
-    ex.AP5_exp=1;
-    ex.RY_exp =0;
-    printf(" ==> sim ACSF, AP5: isi=%0.0f \n\n", isi);
-   } 
-   else if (RyR == 1) 
+      const char * out = "csv";
+      
+      if (sensors.size() > 1) 
+      {
+         out = sensor_dirs[sensors[m]];   // one directory per model
+         
+         if (stat(out, &sb) != 0) {
+            mkdir(out, 0700);
+         }
+      }
+      
+      for(size_t k=0; k < isi.size(); ++k) {
+         ex.push_back( experiment(argc, argv, isi[k], seconds[k], trials, AP5, RyR, astro, sweep, sensors[m], out) );
+      }
+   }
+   
+   printf(" %d worker threads, %d trials per batch (%s)\n", shared_pool(ex[0].threads).size(), LANES, batch_isa());
+   
+   if (ex[0].tables) {   // built here, before the workers read it
+      printf(" voltage tables of %d points, relative error %.1e\n", VoltageTable::NODES, voltage_table().error);
+   }
+   
+   std::vector<double *> pr_ACSF_barChart, pr_BLOCKER_barChart;
+   
+   for(size_t k=0; k < ex.size(); ++k) {
+      pr_ACSF_barChart.push_back( init_double(ex[k].bins) );     // array of doubles
+      pr_BLOCKER_barChart.push_back( init_double(ex[k].bins) ); 
+   }
+   
+   int save_data=1;
+   
+   if (ex[0].meanfield == MEANFIELD_CHECK) 
    {
-    ex.AP5_exp=0;
-    ex.RY_exp = 1;
-    printf(" ==> sim ACSF, RyR: isi=%0.0f \n\n", isi);
+      meanfield_check(ex);
+      
+      for(size_t k=0; k < ex.size(); ++k) {
+         ex[k].meanfield = 1;
+      }
    }
-   else 
+   
+   const char * method = option(argc, argv, "fit");   // nm or cmaes, see fit.h
+   
+   if (method != 0)
    {
-    printf("No blocker was specified.\n");
-    return 0;
+      const char * names = option(argc, argv, "fit_params");   // the default is the Hill sensor's, the others read vca only
+      
+      FitResult fitted = fit(ex, method, names ? names : "n1,Kd1,n2,Kd2", 
+                             (int) option(argc, argv, "fit_evals", 200), (int) option(argc, argv, "fit_reps", 2));
+      
+      for(size_t k=0; k < ex.size(); ++k) {
+         fit_parameters_of(ex[k], fitted.best);   // the runs below are of the best
+         ex[k].meanfield = 0;                     // ... with trials:  a mean field is for the scan
+      }
    }
    
-   int fit_hill=0;    int save_data=1;
+   for(size_t k=0; k < ex.size(); ++k)
+   {
+      if (ex[k].hazard != HAZARD_CHECK) {
+         continue;
+      }
+      if (hazard_check(ex[k]) < 0.001) {
+         fprintf(stderr, "hazard check failed:  the releases by inverse hazard differ from those of a draw per step\n");
+         exit(1);
+      }
+      ex[k].hazard = 1;
+   }
    
-   if( ! fit_hill)
    {
-      sim(pr_ACSF_barChart, pr_BLOCKER_barChart, ex, save_data);  // ex.astro, coupled with astro or not
-                          // isi=75 is only for PPF experiments
-      if (ex.isi != 75) {
-         score(pr_ACSF_barChart, pr_BLOCKER_barChart, ex);
+      // The experiments run at the same time, their trials share the worker pool.
+      std::vector<std::thread> runs;
+      
+      for(size_t k=0; k < ex.size(); ++k) 
+      {
+         runs.push_back( std::thread( [&, k]() {
+            sim(pr_ACSF_barChart[k], pr_BLOCKER_barChart[k], ex[k], save_data);  // ex.astro, coupled with astro or not
+         }));
+      }
+      
+      for(size_t k=0; k < runs.size(); ++k) {
+         runs[k].join();
+      }
+      
+      for(size_t k=0; k < ex.size(); ++k) 
+      {                    // isi=75 is only for PPF experiments
+         if (ex[k].isi != 75) {
+            if (sensors.size() > 1) {
+               printf("\n %s calcium sensor", sensor_names[ex[k].sensor]);
+            }
+            score(pr_ACSF_barChart[k], pr_BLOCKER_barChart[k], ex[k]);
+         }
       }
    }
    
-//    if(fit_hill) 
-//    { 
-//       fit(pr_ACSF_barChart, pr_BLOCKER_barChart, ex);
-//    }
-     
+   output_writer().flush();   // all files written
+   
    printf("----------------------------------------\n");
    printf("\n    Simulation done.    \n");
    printf("----------------------------------------\n");
             
    return 0;
 }
-
-      
\ No newline at end of file
@@ -19,26 +19,30 @@ mainTitle = sprintf('%d Hz, %s, %s Calcium Sensor', hertz, ex, sensor);
 %     'FontSize', 12, 'FontWeight', 'bold');
 sgtitle({mainTitle ' '  ' '});
 
-B.v    = load('csv/bv.csv');
+% traces of the last trial, see load_traces.m
+T  = load_traces('csv/trace.bin');
+TB = load_traces('csv/trace_BLOCKER.bin');
+
+B.v    = T.bv;
 
 tme=1:length(B.v);
 tme=tme./(1000/0.05);
 
-B.c    = load('csv/bc.csv');
-B.Gsyn = load('csv/bg.csv');
+B.c    = T.bc;
+B.Gsyn = T.bg;
 
-B.ca_vgcc = load('csv/b_ca_VGCC.csv');
-B.ca_nmdaR = load('csv/b_ca_PreNMDAR.csv');
-B.ca_nmdaR_mean = load('csv/b_ca_PreNMDAR_mean.csv');
+B.ca_vgcc = T.b_ca_VGCC;
+B.ca_nmdaR = T.b_ca_PreNMDAR;
+B.ca_nmdaR_mean = T.b_ca_PreNMDAR_mean;
 
-B.ca_md = load('csv/b_ca_MD.csv');
-B.ca_md_BLOCKER = load('csv/b_ca_MD_BLOCKER.csv');
+B.ca_md = T.b_ca_MD;
+B.ca_md_BLOCKER = TB.b_ca_MD_BLOCKER;
 
 % B.ca_md_vgcc  = load('csv/b_ca_MD_vgcc.csv');
 % B.ca_md_ryr   = load('csv/b_ca_MD_ryr.csv');
 
-B.ca_ryr = load('csv/b_ca_RyR.csv');
-B.cer = load('csv/b_cer.csv');
+B.ca_ryr = T.b_ca_RyR;
+B.cer = T.b_cer;
 
 % from the current simulation at X Hz
 
@@ -46,11 +50,11 @@ B.cer = load('csv/b_cer.csv');
 B.pr = load('csv/pr.csv');
 B.prBLOCKER = load('csv/prBLOCKER.csv');
 
-B.ca_vgcc_ryr = load('csv/b_ca_vgcc_ryr.csv');
+B.ca_vgcc_ryr = T.b_ca_vgcc_ryr;
 
 % continuous
-B.ves.Prel         = load('csv/b_ves_P_release.csv');
-B.ves.Prel_BLOCKER = load('csv/b_ves_P_release_BLOCKER.csv');
+B.ves.Prel         = T.b_ves_P_release;
+B.ves.Prel_BLOCKER = TB.b_ves_P_release_BLOCKER;
 
 FREQ = fix(1000/isi);
 
@@ -19,14 +19,16 @@ clf;
 mainTitle = sprintf('%d Hz, %s Calcium Sensor, Astrocyte', Hertz,sensor);
 sgtitle(mainTitle);
 
-B.c    = load('csv/bc.csv');
-B.Gsyn = load('csv/bg.csv');
+T = load_traces('csv/trace.bin');   % traces of the last trial
 
-A.aip3  = load('csv/a_ip3.csv');
-A.ca    = load('csv/a_ca.csv');
-A.Gsyn  = load('csv/a_Gsyn.csv');
+B.c    = T.bc;
+B.Gsyn = T.bg;
 
-S.Vm  = load('csv/s_Vm.csv');
+A.aip3  = T.a_ip3;
+A.ca    = T.a_ca;
+A.Gsyn  = T.a_Gsyn;
+
+S.Vm  = T.s_Vm;
 
 tme=1:length(A.ca);
 tme=tme./(1000/0.05);
@@ -8,8 +8,10 @@
 % The model is implemented in the AN_STP.cpp file, which is compiled by 
 % by the GNU C++ compiler g++, or gcc depending on your platform.
 % 
-% The output of the C++ executable (a.out) is saved to csv files.
-% The Matlab script AN_STP_plots.m loads the csv data files and 
+% The output of the C++ executable (a.out) is saved to the csv directory:
+% bar charts as csv files, traces in csv/trace.bin and csv/trace_BLOCKER.bin
+% (csv files too if run with csv=1).
+% The Matlab script AN_STP_plots.m loads the data files and 
 % generates plots.
 
 clear;
@@ -35,10 +37,10 @@ end
 
 linux = 1;  % else Windows
 
-% compile from cmd line:$ g++ -w Main.cpp ./lib/*.h -DHill -I lib/ 
+% compile from cmd line:$ g++ -w -O2 -pthread Main.cpp -DHill -I lib/ 
 
 if (linux==1) 
-    cmd_line=sprintf('g++ -w Main.cpp lib/*.cpp -D%s -I lib/', sensor_model);
+    cmd_line=sprintf('g++ -w -O2 -pthread Main.cpp -D%s -I lib/', sensor_model);
     prog_cpp='./a.out';  
 else 
     return
@@ -56,6 +58,7 @@ fprintf(cmd_line);
 
 
 choices=7;  %[1,2,5,7];     % 1=1Hz,  2=5Hz,  3=10Hz,  4=75 isi,  5=20Hz,  6=40Hz,  7=50Hz   +astro+spine
+                            % 8=all of them in one run (sweep)
 
 TRIALS=10;
 
@@ -74,6 +77,9 @@ cmd6 = sprintf('%s %d  %0.2f %d %s', prog_cpp, 25, 0.25, TRIALS, cond);
 cmd7 = sprintf('%s %d  %0.2f %d %s', prog_cpp, 10, 0.10, TRIALS, cond);
 cmd8 = sprintf('%s %d  %0.2f %d %s', prog_cpp, 75, 0.15, TRIALS, cond);
 
+% one process for all the isis, the experiments share the worker threads 
+cmd_sweep = sprintf('%s 1000,200,100,75,50,25,10 10,2,1,0.75,0.5,0.25,0.1 %d %s', prog_cpp, TRIALS, cond);
+
 for ch=choices  % ch in list of menu choices
 
     ex='10-spikes';  % ex=experiment 
@@ -147,6 +153,11 @@ for ch=choices  % ch in list of menu choices
         end
     end
     
+    if (ch == 8)   % 1 .. 100 Hz in one run, bar charts only
+        disp('sweep: 1000, 200, 100, 75, 50, 25, 10 isi');
+        system(cmd_sweep, '-echo');
+    end
+    
     % Ryanodine receptor experiments (Paired Pulse Facilitation).
     %
     % Test case designed to replicate results reported in the paper by
@@ -87,16 +87,18 @@ static constexpr double R_in=0.7985e+8;    // Input resistance of dendrite spine
 static constexpr double tau_mem=50;        // Post-synaptic membrane time constexprant; ms; Tsodyks & Markram (1997)
 
 //------ Astrocyte Variables -------------
-double * ca;      // Calcium concentration
-double * ax;      // IP3R gating variable
-double * a_ip3;   // IP3 concentration
-double * aO1;     // S1 with calcium bound 
-double * aO2;     // S2 with calcium bound
-double * aO3;     // S3 with calcium bound
-double * aE_syn;  // Fraction of effective SLMV in extra-synaptic cleft 
-double * aI_syn;  // Fraction of inactivated SLMV
-double * aR_syn;  // Fraction of releasable SLMV
-double * aG_syn;  // Glutamate concentration in extra-synaptic cleft
+Trace ca;      // Calcium concentration
+Trace ax;      // IP3R gating variable
+Trace a_ip3;   // IP3 concentration
+Trace aO1;     // S1 with calcium bound 
+Trace aO2;     // S2 with calcium bound
+Trace aO3;     // S3 with calcium bound
+Trace aE_syn;  // Fraction of effective SLMV in extra-synaptic cleft 
+Trace aI_syn;  // Fraction of inactivated SLMV
+Trace aR_syn;  // Fraction of releasable SLMV
+Trace aG_syn;  // Glutamate concentration in extra-synaptic cleft
+
+Random rng;       // random numbers for the IP3R noise, seeded for each trial
  
  
 
@@ -112,16 +114,16 @@ Astro::Astro() { ; }
 
 Astro::Astro(int tn) 
 {    
-    ca=    init_double(tn+2);  
-    ax=    init_double(tn+2);
-    a_ip3= init_double(tn+2);
-    aO1=   init_double(tn+2);
-    aO2=   init_double(tn+2); 
-    aO3=   init_double(tn+2);  
-    aE_syn= init_double(tn+2);   
-    aI_syn= init_double(tn+2);
-    aR_syn= init_double(tn+2);  
-    aG_syn= init_double(tn+2);  
+    ca=    Trace(tn);  
+    ax=    Trace(tn);
+    a_ip3= Trace(tn);
+    aO1=   Trace(tn);
+    aO2=   Trace(tn); 
+    aO3=   Trace(tn);  
+    aE_syn= Trace(tn);   
+    aI_syn= Trace(tn);
+    aR_syn= Trace(tn);  
+    aG_syn= Trace(tn);  
 }
 
 void Astro::set(int tn) 
@@ -166,9 +168,9 @@ double atau3=(akk3*ca[i]+ak_3);  // closure of O3; per ms
 
 //IP3 production & degradation terms.     All are from De Pitta et al (2009)
 double aplcb_ca= 1+(aK_P/aK_R)*(ca[i]/(ca[i]+aK_pi));  // Calcium-dependent inhibition of 'ap_glu'
-double ap_glu=  av_plcb* pow( G_syn, 0.7) / (pow(G_syn, 0.7) + pow((aK_R*aplcb_ca),0.7));      // Agonist-dep IP3 production
-double ap_plcd= av_plcd*(1/(1+(a_ip3[i]/ak_plcd)))*pow(ca[i],2)/(pow(ca[i],2)+pow(aK_plcd,2)); // Agonist-indep IP3 production
-double ap_mapk= av_3K* (pow(ca[i],4)/(pow(ca[i],4) + pow(aK_D,4))) *(a_ip3[i]/(a_ip3[i]+aK3)); // IP3 deg due to IP3-3K
+double ap_glu=  av_plcb* hill(G_syn, aK_R*aplcb_ca, 0.7);      // Agonist-dep IP3 production
+double ap_plcd= av_plcd*(1/(1+(a_ip3[i]/ak_plcd)))*hill<2>(ca[i], aK_plcd); // Agonist-indep IP3 production
+double ap_mapk= av_3K* hill<4>(ca[i], aK_D) *(a_ip3[i]/(a_ip3[i]+aK3)); // IP3 deg due to IP3-3K
 
 double ap_deg=ar5p*(a_ip3[i]);  // IP3 degradation due to IP-5P
 
@@ -183,8 +185,8 @@ double aninf=ca[i]/(ca[i]+ad5);  // Steaty-state functions governing IP3 & Ca2+
 double auer=(ac0-ca[i])/ac1;     // ER Calcium concentration
 
 // Box-Muller Algorithm (Fox, 1997) for noise-term in equation (12) of Tewari & Majumdar 2012.
-double au1=rnd();   
-double au2=rnd();                // uniformly distributed random variables
+double au1=rng.uniform();   
+double au2=rng.uniform();        // uniformly distributed random variables
 
 double aa=((aaq*(1-ax[i])-abq*ax[i]))/aNa;  // co-variance 
 double dW=sqrt(-(2*deltaT*(aa)*log(au1)))*cos(2* M_PI *au2);  // independent Gaussian random number
@@ -200,9 +202,9 @@ else {
 //printf("%f %f  %f \n", ax[i], aaq, abq);
 //ax[i]=1.0;   // 0.5 an .75 drops down to 60,  1.0 goes up and oscillates
 
-double ajchan = ac1*av1*pow(aminf,3) * pow(aninf,3)* pow(ax[i],3)*(ca[i]-auer);  // Calcium flux through IP3R
+double ajchan = ac1*av1*ipow<3>(aminf) * ipow<3>(aninf)* ipow<3>(ax[i])*(ca[i]-auer);  // Calcium flux through IP3R
 
-double ajpump = av3*pow(ca[i],2) / ( pow(ak3,2)+pow(ca[i],2) );  // SERCA pump flux
+double ajpump = av3*hill<2>(ca[i], ak3);  // SERCA pump flux
 
 double ajleak = ac1*av2*(ca[i]-auer);  // Calcium leak from cytosol into ER
   
@@ -0,0 +1,571 @@
+//! Lane-batched trials
+/*!
+  The trials of a condition integrate the same equations and differ only in
+  their random numbers, so a block of LANES trials can be stepped in lockstep,
+  one trial per SIMD lane.  The state of the block is kept as structure of
+  arrays, one element per lane, e.g. ca_local[k] is the local [Ca] of lane k.
+
+  Values that do not depend on the random numbers (the Hodgkin-Huxley
+  variables, the VGCC current and ca_VGCC, the refractory period of the
+  vesicle) are the same in every lane and are computed once per step, or
+  read from the Drive that sim() integrated once for the whole experiment.  The
+  rest is computed lane by lane;  release is a lane mask:  only the lanes
+  inside a release window and out of their refractory period compute Pr and
+  draw a random number, so each lane uses exactly the random numbers the
+  scalar trial() would, and the results are the same bit for bit.  With
+  ex.rb the lanes in the window compute Pr even in their refractory period,
+  for the expectation of the release (see WindowRelease).
+
+  Only what the bar charts and ca_PreNMDAR depend on is computed:  the spine
+  and the astrocyte do not feed back into release and are left out, so
+  trials() runs a trial that is recorded by probes on the scalar path, and
+  the trials of an Ensemble of anything but b_ca_PreNMDAR as well.
+
+  The kernel is compiled for AVX-512, AVX2 and the baseline instruction set
+  (target_clones), and the best one for the CPU is picked when the program
+  starts.  LANES does not depend on it, nor does the result:  floating point
+  contraction is off, so no instruction set fuses a multiply and an add that
+  the scalar code rounds twice.
+
+  With the exponential integrator (ex.integrator) the lanes take the same
+  exponential steps as the scalar code, with the decay factors computed once.
+
+  Only the Hill calcium sensor has a batched kernel;  the trials of the other
+  models run one at a time.
+
+  Fast-forward (ex.ff):  between spikes the bouton is mostly at rest and the
+  calcium pools just relax with tau_dec.  When no stimulus is due, the release
+  window is closed, v, m, h and n have stopped moving and the glutamate is
+  gone, up to FF_STEPS time steps are taken at once:  each pool follows the
+  closed form of its Euler recurrence with the fluxes into it held, mc its own
+  relaxation, and the delayed inputs are read half way through.  The rings are
+  filled in at every time point skipped, so the steps that follow read them
+  as usual.  No random number is drawn while the window is closed, so the 
+  lanes still use the same streams as the scalar trials.  The trial recorded
+  by probes runs on the scalar path, every time point of it, as do all the
+  trials of the other sensors, of batch=0 and of an ensemble of variables
+  other than b_ca_PreNMDAR;  for those experiment() turns ff off.
+*/
+
+#ifndef _utilities_h_included_
+#define _utilities_h_included_
+#include "utilities.h"
+#endif
+
+#ifndef _synapse_h_included_
+#define _synapse_h_included_
+#include "synapse.h"
+#endif
+
+#ifndef _ensemble_h_included_
+#define _ensemble_h_included_
+#include "ensemble.h"
+#endif
+
+// Trials stepped side by side:  one AVX-512 or two AVX2 vectors of doubles.
+static constexpr int LANES=8;
+
+// Fast-forward (ex.ff):  time steps taken at once, at most, and how still the
+// bouton must be:  change per step of v (mV) and the gates, and glutamate (mM).
+static constexpr int    FF_STEPS=100;
+static constexpr double FF_TOL=1e-7;
+
+
+// The instruction set the batched kernel runs with on this CPU.
+const char * batch_isa()
+{
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f")) {
+        return "avx512f";
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return "avx2";
+    }
+    return "sse2";
+}
+
+
+// No batched kernel for this calcium sensor model:  returns 0, and trials()
+// runs the trials one at a time.
+template <class Vesicle>
+int batch_trials(Synapse<Vesicle> &, EX &, int, int, int, int, int, double *, double *, Ensemble *)
+{
+    return 0;
+}
+
+
+//! Hill sensor trials first .. first+count-1  (count <= LANES) in lockstep
+/*!
+Adds their release events to barChart, like trial(), and if trialCharts is not
+0 those of trial n to its row n-1 (see trials()) as well.  If ens is not 0,
+their ca_PreNMDAR to it, in trial order;  it must keep no other variable of 
+the condition (Ensemble::only()).  Same equations,
+in the same order, as Bouton::bouton_model(), VGCC_bouton::I_Ca(),
+PreNMDAR::I_Ca(), RyR::Jcicr() and Vesicle_Hill::release(), with the 
+constants of those classes.
+*/
+__attribute__(( target_clones("avx512f", "avx2", "default"), optimize("fp-contract=off") ))
+int batch_trials(Synapse<Vesicle_Hill> & s, EX & ex, int AP5, int RY, int BLOCKER, int first, int count, double * barChart, double * trialCharts, Ensemble * ens)
+{
+    typedef Bouton<Vesicle_Hill> B;
+    typedef Vesicle_Hill V;
+
+    const int L = LANES;
+
+    double deltaT = ex.deltaT;
+
+    // constants of bouton_model(), as it computes them
+    double Fmicro = B::F/1e6;
+
+    double delay_time_steps = B::delay_steps(ex);
+
+    // ca_local, cer and G_syn are read delay_time_steps back:  rings of R time
+    // points, R a power of 2, lane k of time point i at [i & mask][k].
+    int delay = (int) ceil(delay_time_steps) + 1;
+    int R = 4;
+    while (R < delay + 3 || R <= FF_STEPS) {
+        R *= 2;
+    }
+    int mask = R-1;
+
+    double (*ca_local)[LANES] = new double[R][LANES]();
+    double (*cer)[LANES]      = new double[R][LANES]();
+    double (*G_syn)[LANES]    = new double[R][LANES]();
+
+    // per lane state
+    double ca_RyR[LANES], J_flux[LANES], syn[LANES], ca_PreNMDAR[LANES], E_syn[LANES], lastRelease[LANES];
+    double fluxRyR[LANES], fluxPreNMDAR[LANES], REL[LANES];
+    double BAR[LANES];   // what the bars count:  REL, or with ex.rb its expectation
+    Random rng[LANES];
+    std::vector<double> pre[LANES];   // ens:  ca_PreNMDAR of every time point
+    WindowRelease spike_release[LANES];
+    HazardRelease sampler[LANES];   // ex.hazard
+
+    for(int k=0; k < L; ++k)
+    {
+        rng[k].seed(ex.seed, ex.paired ? 0 : BLOCKER, first+k, RNG_VESICLE);
+
+        ca_local[1][k] = B::c_rest_bouton;
+        cer[1][k]      = ER::c_rest_ER;
+        G_syn[1][k]    = V::G_rest;
+
+        ca_RyR[k]=0;
+        J_flux[k]=0;
+        syn[k]=0;
+        ca_PreNMDAR[k]=0;
+        E_syn[k]=0;
+        lastRelease[k]=-100;
+        spike_release[k].reset();
+        sampler[k].reset();
+        
+        if (ens != 0) {
+            pre[k].assign(ex.tn+2, 0);
+        }
+    }
+
+    // the same in every lane
+    double v=B::vr, m=B::m_rest, h=B::h_rest, n=B::n_rest;
+    double mc=0, ca_VGCC=0;
+    double lastSpike=-100;
+
+    double gc  = s.B.vgcc.gc;
+    double Vca = s.B.vgcc.Vca;
+    double Vca_nmda = s.B.nmdaR.Vca;
+
+    double Pr_Kd = ipow(ex.Kd1, ex.n1);   // as hill() computes it
+
+    int binNumber=0;
+
+    int stim=0;   // fast-forward:  next time point with a stimulus, ex.Iapp != 0
+
+    // exponential integrator:  decay factors of one time step, as relax() computes them
+    int rl = ex.integrator != INTEGRATOR_EULER;
+
+    double e_dec    = exp(-deltaT/B::tau_dec);
+    double e_inact  = exp(-deltaT/V::tau_inact);
+    double e_G      = exp(-deltaT/(1/V::degG));
+    double tau_G    = 1/V::degG;
+
+    double a_dec = rl ? e_dec : 1 - deltaT/B::tau_dec;   // per step decay of a pool with its inputs held
+
+    double a_pow[FF_STEPS+1];   // a_dec^j
+    for(int j=0; j <= FF_STEPS; ++j) {
+        a_pow[j] = pow(a_dec, j);
+    }
+
+    // the membrane of every step from sim(), except when fast-forward jumps through it
+    Drive * drive = ex.ff ? 0 : ex.drive;
+
+    for(int i=1; i <= ex.tn; ++i)
+    {
+        double t = ex.t[i];
+
+        // ------- uniform:  Hodgkin-Huxley, VGCC, refractory period -------
+
+        double v1, m1, h1, n1, mc1, ca_VGCC1, fluxVGCC, mcinf=0, unblock;
+
+        if (drive != 0)   // integrated once by sim(), see Drive
+        {
+            Drive & D = *drive;
+
+            v1=D.v[i+1];  m1=D.m[i+1];  h1=D.h[i+1];  n1=D.n[i+1];
+            mc1=D.mc[i+1];
+            ca_VGCC1=D.ca_VGCC[i+1];
+
+            fluxVGCC = (-D.Ivgcc[i] * 1)/(2 * Fmicro * B::DCa * B::vgcc_distance);
+            unblock  = ex.tables ? voltage_table()(VT_MG, v) : voltage_function(VT_MG, v);
+        }
+        else
+        {
+            double y[VT_FUNCTIONS];   // an ... bh, mcinf, Mg++ unblock
+
+            if (ex.tables) {
+                voltage_table().lookup(v, y);
+            }
+            else {
+                for(int f=0; f < VT_FUNCTIONS; ++f) {
+                    y[f] = voltage_function(f, v);
+                }
+            }
+            double an=y[VT_AN], bn=y[VT_BN], am=y[VT_AM], bm=y[VT_BM], ah=y[VT_AH], bh=y[VT_BH];
+
+            double I_Na   = B::gna* (v-B::vna);
+            double I_K    = B::gk * (v-B::vk);
+            double I_Leak = B::gl * (v-B::vl);
+
+            if ( ! rl )
+            {
+                m1 =m+deltaT*(am*(1-m)-bm*m);
+                h1 =h+deltaT*(ah*(1-h)-bh*h);
+                n1 =n+deltaT*(an*(1-n)-bn*n);
+                v1 =v+deltaT*( ex.Iapp[i] - (ipow<3>(m)*h* I_Na + ipow<4>(n) * I_K + I_Leak) );
+            }
+            else
+            {
+                m1 = rush_larsen(m, am, bm, deltaT);
+                h1 = rush_larsen(h, ah, bh, deltaT);
+                n1 = rush_larsen(n, an, bn, deltaT);
+
+                double g_Na = B::gna*ipow<3>(m)*h;
+                double g_K  = B::gk *ipow<4>(n);
+                double g    = g_Na + g_K + B::gl;
+
+                v1 = relax(v, ex.Iapp[i] + g_Na*B::vna + g_K*B::vk + B::gl*B::vl, 0, 1/g, ex);
+            }
+
+            mcinf=y[VT_MCINF];
+            mc1 = rl ? relax(mc, mcinf/VGCC_bouton::tau_mc, 0, VGCC_bouton::tau_mc, ex)
+                     : mc+deltaT*((mcinf - mc)/VGCC_bouton::tau_mc);
+
+            double sensor_vgcc = hill_inhibition<VGCC_bouton::n_inact>(ca_VGCC, VGCC_bouton::Kd_inact);
+            double Ivgcc = gc * sensor_vgcc * ipow<2>(mc) * (v-Vca);
+
+            fluxVGCC = (-Ivgcc * 1)/(2 * Fmicro * B::DCa * B::vgcc_distance);
+            ca_VGCC1 = relax(ca_VGCC, fluxVGCC, 0, B::tau_dec, ex);
+
+            unblock = y[VT_MG];
+        }
+
+        double Mg_block = 1/( 1 + unblock * (PreNMDAR::Mg/PreNMDAR::K_Mg) );
+
+        if ( t - lastSpike > V::refractory  &&  v > -40 ) {
+            lastSpike = t;
+
+            for(int k=0; k < L; ++k) {
+                spike_release[k].begin(lastRelease[k]);
+            }
+        }
+        int synch = (t - lastSpike) <= V::window;
+
+        int delayed = i > delay_time_steps;
+        int d = ((int) (i - delay_time_steps)) & mask;   // time point read by RyR and preNMDARs
+        int now  = i & mask;
+        int next = (i+1) & mask;
+
+        // ------- fast-forward through a quiescent stretch, if ex.ff -------
+
+        if (ex.ff && ! synch)
+        {
+            if (stim < i)   // next time point with a stimulus
+            {
+                stim = i;
+                while (stim <= ex.tn && ex.Iapp[stim] == 0) {
+                    ++stim;
+                }
+            }
+            int S = (stim - i < FF_STEPS) ? stim - i : FF_STEPS;
+
+            int quiet = S > 1 && fabs(v1-v) < FF_TOL && fabs(m1-m) < FF_TOL && fabs(h1-h) < FF_TOL 
+                              && fabs(n1-n) < FF_TOL;
+
+            for(int k=0; k < L && quiet; ++k) {
+                quiet = E_syn[k] < FF_TOL && G_syn[now][k] < FF_TOL && G_syn[d][k] < FF_TOL;
+            }
+
+            if (quiet)
+            {
+                // S steps at once.  With its inputs held, x[j+1] = x[j] + deltaT*(f - x[j]/tau_dec) 
+                // is x[j] = x* + (x[0] - x*) a^j,  x* = f tau_dec,  a = 1 - deltaT/tau_dec;  
+                // the exponential step is the same with a = exp(-deltaT/tau_dec).
+                double a_sum = (1 - a_pow[S])/(1 - a_pow[1]);   // sum of a^j, j < S
+
+                // delayed inputs, read half way through
+                int d_mid = ((int) (i + S/2 - delay_time_steps)) & mask;
+
+                double x_star = fluxVGCC*B::tau_dec;
+                ca_VGCC = x_star + (ca_VGCC - x_star)*a_pow[S];
+
+                mc = mcinf + (mc - mcinf)*pow(rl ? exp(-deltaT/VGCC_bouton::tau_mc) : 1 - deltaT/VGCC_bouton::tau_mc, S);
+
+                for(int k=0; k < L; ++k)
+                {
+                    // RyR:  J[j+1] = (J_infinity - J[j])/tau_cicr  goes to J* geometrically
+                    double f_RyR = 0;
+                    double cer_S = cer[now][k];
+
+                    if (RY == 0 && delayed)
+                    {
+                        double ca  = ca_local[d_mid][k]/1000;
+                        double cer_uM = cer[d_mid][k]/1000;
+                        double J_infinity = 0;
+                        if (ca > RyR::KT) {
+                            J_infinity = RyR::Vcicr * hill<RyR::n>(ca, RyR::Kcicr) * (cer_uM - ca);
+                        }
+                        double J_star = J_infinity/(1 + RyR::tau_cicr);
+                        double r  = -1/RyR::tau_cicr;
+                        double rS = pow(r, S);
+
+                        f_RyR     = 1000 * (J_star + (J_flux[k] - J_star)*(1 - rS)/((1 - r)*S));   // mean over the S steps
+                        J_flux[k] = J_star + (J_flux[k] - J_star)*rS;
+
+                        x_star = f_RyR*B::tau_dec;
+                        double ca_RyR_sum = S*x_star + (ca_RyR[k] - x_star)*a_sum;
+
+                        ca_RyR[k] = x_star + (ca_RyR[k] - x_star)*a_pow[S];
+                        cer_S = cer[now][k] - deltaT*( (S*f_RyR - ca_RyR_sum/B::tau_dec)/B::c1 );
+                    }
+                    else {
+                        ca_RyR[k]=0;
+                    }
+
+                    // preNMDARs:  syn relaxes to its steady state for the glutamate held
+                    double f_PreNMDAR = 0;
+
+                    if (AP5 == 0)
+                    {
+                        if (delayed)
+                        {
+                            double glu = G_syn[d_mid][k];
+                            double b   = rl ? exp(-(PreNMDAR::a_r*glu + PreNMDAR::a_d)*deltaT) 
+                                            : 1 - deltaT*(PreNMDAR::a_r*glu + PreNMDAR::a_d);
+                            double bS  = pow(b, S);
+                            double syn_star = PreNMDAR::a_r*glu/(PreNMDAR::a_r*glu + PreNMDAR::a_d);
+                            double syn_mean = syn_star + (syn[k] - syn_star)*(1 - bS)/((1 - b)*S);
+
+                            syn[k] = syn_star + (syn[k] - syn_star)*bS;
+
+                            double sensor = hill_inhibition<PreNMDAR::n_inact>(ca_PreNMDAR[k], PreNMDAR::Kd_inact);
+                            double I_Ca = PreNMDAR::gNMDA * sensor * syn_mean * Mg_block * (v - Vca_nmda);
+
+                            f_PreNMDAR = (-I_Ca * 1)/(2*Fmicro * B::DCa * B::nmdaR_distance);
+                        }
+                        x_star = f_PreNMDAR*B::tau_dec;
+
+                        for(int j=1; j <= S && ens != 0; ++j) {
+                            pre[k][i+j] = x_star + (ca_PreNMDAR[k] - x_star)*a_pow[j];
+                        }
+                        ca_PreNMDAR[k] = x_star + (ca_PreNMDAR[k] - x_star)*a_pow[S];
+                    }
+
+                    // the rings are read at fine time points later on
+                    x_star = B::c_rest_bouton + (fluxVGCC + f_RyR + f_PreNMDAR)*B::tau_dec;
+
+                    double ca0  = ca_local[now][k];
+                    double cer0 = cer[now][k];
+                    double glu  = G_syn[now][k];
+
+                    double a_G = rl ? e_G : 1 - deltaT*V::degG;
+
+                    for(int j=1; j <= S; ++j)
+                    {
+                        glu *= a_G;
+
+                        ca_local[(i+j) & mask][k] = x_star + (ca0 - x_star)*a_pow[j];
+                        cer[(i+j) & mask][k]      = cer0 + (cer_S - cer0)*j/S;
+                        G_syn[(i+j) & mask][k]    = glu;
+                    }
+                    E_syn[k] *= pow(rl ? e_inact : 1 - deltaT/V::tau_inact, S);
+                }
+
+                for(int j=0; j < S; ++j) {
+                    binNumber += ex.spikes[i+j];
+                }
+
+                i += S-1;   // v, m, h and n are at rest
+                continue;
+            }
+        }
+
+        // ------- per lane:  RyR, ER -------
+
+        if (RY == 0 && delayed)
+        {
+            for(int k=0; k < L; ++k)
+            {
+                double ca  = ca_local[d][k]/1000;
+                double cer_uM = cer[d][k]/1000;
+                double J_infinity = 0;
+                if (ca > RyR::KT) {
+                    J_infinity = RyR::Vcicr * hill<RyR::n>(ca, RyR::Kcicr) * (cer_uM - ca);
+                }
+                fluxRyR[k] = 1 * (J_flux[k] * 1000);
+                J_flux[k]  = (J_infinity - J_flux[k])/RyR::tau_cicr;
+            }
+            for(int k=0; k < L; ++k)
+            {
+                cer[next][k] = cer[now][k] - deltaT*( (fluxRyR[k] -  (( ca_RyR[k] - 0)/B::tau_dec ))/B::c1 );
+
+                double x_inf = fluxRyR[k]*B::tau_dec;
+                ca_RyR[k]    = rl ? x_inf + (ca_RyR[k] - x_inf)*e_dec
+                                  : ca_RyR[k] + deltaT*(fluxRyR[k] - ((ca_RyR[k] - 0)/B::tau_dec));
+            }
+        }
+        else
+        {
+            for(int k=0; k < L; ++k)
+            {
+                fluxRyR[k]=0;
+                cer[next][k] = cer[now][k] - deltaT*( (fluxRyR[k] -  (( ca_RyR[k] - 0)/B::tau_dec ))/B::c1 );
+                ca_RyR[k]=0;
+            }
+        }
+
+        // ------- per lane:  preNMDARs -------
+
+        if (AP5 == 0)
+        {
+            if (delayed)
+            {
+                for(int k=0; k < L; ++k)
+                {
+                    double sensor = hill_inhibition<PreNMDAR::n_inact>(ca_PreNMDAR[k], PreNMDAR::Kd_inact);
+                    double I_Ca = PreNMDAR::gNMDA * sensor * syn[k] * Mg_block * (v - Vca_nmda);
+
+                    fluxPreNMDAR[k] = (-I_Ca * 1)/(2*Fmicro * B::DCa * B::nmdaR_distance);
+                }
+                for(int k=0; k < L && ! rl; ++k) {
+                    syn[k] = syn[k] + deltaT * (  PreNMDAR::a_r * G_syn[d][k] * (1 - syn[k]) - PreNMDAR::a_d * syn[k]);
+                }
+                for(int k=0; k < L && rl; ++k) {
+                    syn[k] = rush_larsen(syn[k], PreNMDAR::a_r * G_syn[d][k], PreNMDAR::a_d, deltaT);
+                }
+            }
+            else
+            {
+                for(int k=0; k < L; ++k) {
+                    fluxPreNMDAR[k]=0;
+                }
+            }
+            for(int k=0; k < L; ++k) 
+            {
+                double x_inf = fluxPreNMDAR[k]*B::tau_dec;
+                ca_PreNMDAR[k] = rl ? x_inf + (ca_PreNMDAR[k] - x_inf)*e_dec
+                                    : ca_PreNMDAR[k] + deltaT*(fluxPreNMDAR[k] - ((ca_PreNMDAR[k] - 0)/B::tau_dec));
+            }
+
+            for(int k=0; k < L && ens != 0; ++k) {
+                pre[k][i+1] = ca_PreNMDAR[k];
+            }
+        }
+        else
+        {
+            for(int k=0; k < L; ++k) {
+                fluxPreNMDAR[k]=0;
+            }
+        }
+
+        // ------- per lane:  vesicle release, masked -------
+
+        for(int k=0; k < L; ++k) {
+            REL[k]=0;
+            BAR[k]=0;
+        }
+
+        if (synch)
+        {
+            for(int k=0; k < L; ++k)
+            {
+                int ready = (t - lastRelease[k]) > V::refractory;
+
+                if (ready || ex.rb)
+                {
+                    double Ca = ca_local[now][k]/1000.0;
+                    double Ca_n = ipow(Ca, ex.n1);
+                    double Pr = V::Pr_max * ( Ca_n / (Pr_Kd + Ca_n) );
+                    double p  = rl ? -expm1(-Pr*deltaT) : Pr * deltaT;
+
+                    if (ready && (ex.hazard ? sampler[k].step(i, p, rng[k], ex) : (ex.paired ? rng[k].at(i) : rng[k].uniform()) < p))
+                    {
+                        lastRelease[k] = t;
+                        REL[k] = 1.0;
+                    }
+                    if (ex.rb) {
+                        BAR[k] = spike_release[k].step(t, p);
+                    }
+                }
+            }
+        }
+
+        for(int k=0; k < L && ! ex.rb; ++k) {
+            BAR[k] = REL[k];
+        }
+
+        for(int k=0; k < L; ++k)
+        {
+            if ( ! rl )
+            {
+                ca_local[next][k] = ca_local[now][k] + deltaT * \
+                    (fluxVGCC + fluxRyR[k] + fluxPreNMDAR[k]  - (ca_local[now][k] - B::c_rest_bouton)/B::tau_dec);
+
+                G_syn[next][k] = G_syn[now][k] + deltaT*(V::nv*V::gv*E_syn[k] - V::degG*(G_syn[now][k]));
+                E_syn[k]       = E_syn[k] + deltaT*( REL[k] - (E_syn[k]/V::tau_inact) );
+            }
+            else
+            {
+                double x_inf = B::c_rest_bouton + (fluxVGCC + fluxRyR[k] + fluxPreNMDAR[k])*B::tau_dec;
+                ca_local[next][k] = x_inf + (ca_local[now][k] - x_inf)*e_dec;
+
+                x_inf = 0 + V::nv*V::gv*E_syn[k]*tau_G;
+                G_syn[next][k] = x_inf + (G_syn[now][k] - x_inf)*e_G;
+                E_syn[k]       = E_syn[k]*e_inact + REL[k]*REFERENCE_DT;
+            }
+        }
+
+        binNumber += ex.spikes[i];
+
+        if (binNumber >= 1 && binNumber <= 10)
+        {
+            for(int k=0; k < count; ++k) {
+                barChart[binNumber] += BAR[k];
+            }
+            for(int k=0; k < count && trialCharts != 0; ++k) {
+                trialCharts[(first+k-1)*((int) ex.bins+1) + binNumber] += BAR[k];
+            }
+        }
+
+        v=v1;  m=m1;  h=h1;  n=n1;
+        mc=mc1;
+        ca_VGCC=ca_VGCC1;
+    }
+
+    for(int k=0; k < count && ens != 0; ++k) {
+        ens->add(BLOCKER, probe_var("b_ca_PreNMDAR"), pre[k].data());   // in trial order
+    }
+
+    delete[] ca_local;
+    delete[] cer;
+    delete[] G_syn;
+
+    return 1;
+}
@@ -6,6 +6,10 @@
    This bouton has voltage gated calcium channels and presynaptic NMDA receptors
    (preNMDARs) on its plasma membrane, a vesicle object that includes at least one calcium sensor, 
    and an endoplasmic reticulum (ER) with ryanodine receptors (RyR). 
+   
+   The vesicle class, i.e. the calcium sensor model, is a template parameter:  
+   Vesicle_Hill, Vesicle_Markov, Vesicle_Markov_6 or Vesicle_Allosteric.  
+   See sim() for how it is chosen at run time.
 */   
 
 
@@ -19,6 +23,40 @@
 #include "vesicles_hill.h"
 #endif
 
+#ifndef _vesicles_markov_h_included_
+#define _vesicles_markov_h_included_
+#include "vesicles_markov.h"
+#endif
+
+#ifndef _vesicles_markov6_h_included_
+#define _vesicles_markov6_h_included_
+#include "vesicles_markov6.h"
+#endif
+
+#ifndef _vesicles_allosteric_h_included_
+#define _vesicles_allosteric_h_included_
+#include "vesicles_allosteric.h"
+#endif
+
+
+// The voltage dependent functions of the bouton and the NMDA receptors, as
+// voltage_table() keeps them (see vtable.h).
+//
+double voltage_function(int f, double v)
+{
+    switch (f)
+    {
+        case VT_AN:    return 0.01*((-v-60)/(exp((-v-60)/10)-1));
+        case VT_BN:    return 0.125*exp((-v-70)/80);
+        case VT_AM:    return 0.1*((-v-45)/(exp((-v-45)/10)-1));
+        case VT_BM:    return 4*exp((-v-70)/18);
+        case VT_AH:    return 0.07*exp((-v-70)/20);
+        case VT_BH:    return 1/(exp((-v-40)/10)+1);
+        case VT_MCINF: return 1/(1+exp((VGCC_bouton::v_half-v)/VGCC_bouton::slope_factor));
+        default:       return exp(-0.062 * v);   // Mg++ unblock
+    }
+}
+
 #ifndef _er_h_included_
 #define _er_h_included_
 #include "er.h"
@@ -29,6 +67,7 @@
 #include "utilities.h"
 #endif
 
+template <class Vesicle>
 class Bouton 
 {
 public:
@@ -57,6 +96,9 @@ double bouton_sa;                    // Surface area of bouton;  cm^2;   Koester
 // Vleak	 -65 	    -65 
  
 static constexpr double vr= -70;  // Resting membrane potential of bouton;   mV
+static constexpr double m_rest=0.1;   // Gating variable for sodium channel (activation), at rest
+static constexpr double h_rest=0.6;   // Gating variable for sodium channel (inactivation)
+static constexpr double n_rest=0.3;   // Gating variable for potassium channel (activation)
 static constexpr double gna=120;  // Sodium conductance density;  mS/cm^2;   HH (1952)
 static constexpr double gk=36;    // Potassium conductance density; mS/cm^2; HH (1952)
 
@@ -105,36 +147,43 @@ static constexpr double F=96485.33289;  // Faraday's Constant;  Coulombs/mole; h
 
 // time constant for [Ca] decay in milliseconds
 static constexpr  double tau_dec = 100; // bouton avg; 238ms 1/2 decay (Wu 1994),  27ms (p138 Sterrat)                        
+
+// Ca2+ diffusion from the channels to the vesicle, see bouton_model()
+static constexpr double vgcc_distance  = 0.090; // distance from VGCC to vesicle;  .10 um == 100 nm
+// static constexpr double DCa=0.220;           // diffusion coefficient: 0.220 um^2 /ms; 
+static constexpr double DCa=0.050;              // diffusion coefficient: 0.050 um^2/ms   // Nadkarni et al. 2010
+static constexpr double nmdaR_distance = 0.030; // distance from nmdaR to vesicle; um
+//                                  
+// Nadkarni 2012:  50 um^2/s   == 0.05  um^2/ms  
     
 // Pre-synaptic Bouton Variables
 double G_syn;    // Synaptic glutamate concentration
-double * ca_local;     // Calcium concentration near vesicles
-double * ca_global;    // Calcium concentration for bouton (average)
+Trace ca_local;     // Calcium concentration near vesicles
+Trace ca_global;    // Calcium concentration for bouton (average)
 
-double * v;      // Membrane potential
-double * m;      // Sodium channel activation 
-double * h;      // Sodium channel inactivation
-double * n;      // Potassium channel activation
+Trace v;      // Membrane potential
+Trace m;      // Sodium channel activation 
+Trace h;      // Sodium channel inactivation
+Trace n;      // Potassium channel activation
 
 
-double *  Ivgcc;
-double *  IPump;
-double *  ICa_leak;
+Trace  Ivgcc;
+Trace  IPump;
+Trace  ICa_leak;
 
 // Reversal potential for Calcium ion determined through Nernst equation. 
 // Assumes extracellular [Ca2+]=2 mM as in Perea & Araque (2007)
 double vca;
 
 // Receptors
-double * Inmda;
-double * Inmda_Ca;
+Trace Inmda;
+Trace Inmda_Ca;
 
-double * ca_VGCC;
-double * ca_PreNMDAR;
-double * ca_PreNMDAR_mean;
+Trace ca_VGCC;
+Trace ca_PreNMDAR;   // its mean over the trials:  see Ensemble
 
-double * ca_RyR;
-double * ca_VGCC_RyR;
+Trace ca_RyR;
+Trace ca_VGCC_RyR;
 
 //double * ca_IP3R;
 
@@ -144,32 +193,24 @@ VGCC_bouton vgcc;
 
 
 
-#ifdef Hill
-Vesicle_Hill ves;
-#endif
-
-#ifdef Markov
-Vesicle_Markov ves;
-#endif 
-
-#ifdef Markov6
-Vesicle_Markov_6 ves;
-#endif 
-
-#ifdef Allosteric
-Vesicle_Allosteric ves;
-#endif 
+Vesicle ves;   // calcium sensor model
 
 
 ER er;       
 
-Bouton() { ; }
+int hoisted;   // 1:  v ... ca_VGCC are those of a Drive, see share()
+
+Bouton() { hoisted=0; }
 
-Bouton(int tn, double v_ca) 
+// With a drive the membrane traces are those of the Drive (see share()),
+// none of its own.
+//
+Bouton(int tn, double v_ca, Drive * drive=0) 
 {    
     
 
     vca = v_ca;  
+    hoisted = 0;
     bouton_vol= 0.13;  // 1e-3 * (4.0/3.0) * M_PI *pow(bouton_rad,3);  // Volume of bouton; liter; Koester & Sakmann (2000)
     domain_vol=bouton_vol/10000;   // hypothetical volume of the channel domain, volume at source of Ca2+ influx 
     
@@ -183,53 +224,44 @@ Bouton(int tn, double v_ca)
     bouton_sa= 1;  // 4* M_PI *pow(bouton_rad,2);  //bouton surface area; cm^2 Koester & Sakmann (2000)
     //
     // Pre-synaptic Bouton Variables
-    ca_local  =  init_double(tn);   // Calcium concentration (local,  for vesicles)
-    ca_global =  init_double(tn);   // Calcium concentration (global, for bouton)
+    ca_local  =  Trace(tn);   // Calcium concentration (local,  for vesicles)
+    ca_global =  Trace(tn);   // Calcium concentration (global, for bouton)
     
-    v=   init_double(tn);   // Membrane potential
-    m=   init_double(tn);   // Sodium channel activation 
-    h=   init_double(tn);   // Sodium channel inactivation
-    n=   init_double(tn);   // Potassium channel activation
-
-    Ivgcc   = init_double(tn);
-    IPump   = init_double(tn);
-    ICa_leak= init_double(tn);
+    if (drive == 0) {
+       v=   Trace(tn);   // Membrane potential
+       m=   Trace(tn);   // Sodium channel activation 
+       h=   Trace(tn);   // Sodium channel inactivation
+       n=   Trace(tn);   // Potassium channel activation
+
+       Ivgcc   = Trace(tn);
+       ca_VGCC = Trace(tn); 
+    }
+    IPump   = Trace(tn);
+    ICa_leak= Trace(tn);
        
     // Receptors on Bouton
-    Inmda     = init_double(tn);     
-    Inmda_Ca  = init_double(tn); 
+    Inmda     = Trace(tn);     
+    Inmda_Ca  = Trace(tn); 
     
     // printf("\n bouton.h line 158, tn = %d \n", tn);
     nmdaR = PreNMDAR(tn, vca);
     
-    ca_VGCC          = init_double(tn); 
-    ca_PreNMDAR      = init_double(tn); 
-    ca_PreNMDAR_mean = init_double(tn); 
+    ca_PreNMDAR      = Trace(tn); 
     
-    ca_RyR      = init_double(tn);
-    ca_VGCC_RyR = init_double(tn);
+    ca_RyR      = Trace(tn);
+    ca_VGCC_RyR = Trace(tn);
        
     // ca_IP3R = init_double(tn); 
     
-    vgcc = VGCC_bouton(tn, vca); 
-    
-    #ifdef Markov
-    ves = Vesicle_Markov(tn);
-    #endif
+    vgcc = VGCC_bouton(drive ? 0 : tn, vca); 
     
-    #ifdef Markov6
-    ves = Vesicle_Markov_6(tn);
-    #endif
-    
-    #ifdef Allosteric
-    ves = Vesicle_Allosteric(tn);
-    #endif 
-    
-    #ifdef Hill
-    ves = Vesicle_Hill(tn);
-    #endif
+    ves = Vesicle(tn);
 
     er = ER(tn);
+    
+    if (drive != 0) {
+       share(*drive);
+    }
 };
   
   
@@ -240,19 +272,12 @@ void set(int tn)
        ca_local[i]  =0;   // Calcium concentration
        ca_global[i] =0;
        
-       v[i]=0;   // Membrane potential
-       m[i]=0;   // Sodium channel activation 
-       h[i]=0;   // Sodium channel inactivation
-       n[i]=0;   // Pottassium channel activation
-   
-       Ivgcc[i]=0;
        IPump[i]=0;
        ICa_leak[i]=0;
        
        Inmda[i]=0;     
        Inmda_Ca[i]=0; 
        
-       ca_VGCC[i]=0;
        ca_PreNMDAR[i]=0;
        ca_RyR[i]=0;
     }
@@ -262,16 +287,62 @@ void set(int tn)
     ca_local[1] =c_rest_bouton;  
     ca_global[1]=c_rest_bouton;          
     
-    v[1]=-70;  // Resting membrane potential of bouton;  mV
-    m[1]=0.1;  // Gating variable for sodium channel (activation)
-    h[1]=0.6;  // Gating variable for sodium channel (inactivation)
-    n[1]=0.3;  // Gating variable for potassium channel (activation)
- 
     Inmda[1]=0;
     Inmda_Ca[1]=0;
+    
+    nmdaR.set();
+    
+    if ( ! hoisted ) {
+        set_membrane(tn);
+    }
 };  
-  
-void bouton_model(int i, EX ex, double aG_syn, int AP5, int RY) 
+
+// Initial conditions of the membrane, see membrane_model().
+void set_membrane(int tn)
+{
+    for(int i = 1; i < tn+1; ++i)
+    {
+       v[i]=0;   // Membrane potential
+       m[i]=0;   // Sodium channel activation 
+       h[i]=0;   // Sodium channel inactivation
+       n[i]=0;   // Pottassium channel activation
+   
+       Ivgcc[i]=0;
+       ca_VGCC[i]=0;
+    }
+    
+    v[1]=vr;
+    m[1]=m_rest;
+    h[1]=h_rest;
+    n[1]=n_rest;
+ 
+    vgcc.set();
+};
+
+// Shares the membrane traces of d instead of integrating them, see Drive.
+void share(Drive & d);
+
+// Ca2+ flux from the cluster of VGCCs at time point i, see bouton_model().
+double flux_VGCC(int i)
+{
+    double Fmicro = F/1e6;
+    return (-Ivgcc[i] * 1)/(2 * Fmicro * DCa * vgcc_distance); 
+}
+
+// Time steps by which RyR and the preNMDARs lag ca_local, cer and the glutamate:
+// ex.beg_pad (ms), the padding, plus 1 ms.
+static double delay_steps(EX & ex)
+{
+    return (ex.beg_pad + 1.0)/ex.deltaT;
+}
+
+//! Membrane from time point i to i+1
+/*!
+The Hodgkin-Huxley potential v and gates m, h and n, the VGCC gate, Ivgcc[i] 
+and ca_VGCC.  They depend on the stimulus ex.Iapp only:  nothing stochastic
+and nothing downstream of them (release, preNMDARs, RyR) feeds back.
+*/
+void membrane_model(int i, EX & ex)
 {
     // Gating Variables
     // an Opening: K channel activation 
@@ -281,35 +352,70 @@ void bouton_model(int i, EX ex, double aG_syn, int AP5, int RY)
     // ah Opening: inactivation of Na channel
     // aq Closing: inactivation of Na channel
 
-    double an=0.01*((-v[i]-60)/(exp((-v[i]-60)/10)-1)); 
-    double bn=0.125*exp((-v[i]-70)/80);                
-    double am=0.1*((-v[i]-45)/(exp((-v[i]-45)/10)-1)); 
-    double bm=4*exp((-v[i]-70)/18);      
-    double ah=0.07*exp((-v[i]-70)/20);   
-    double bh=1/(exp((-v[i]-40)/10)+1);   
+    double an, bn, am, bm, ah, bh;
+
+    if (ex.tables)
+    {
+        double y[VT_FUNCTIONS];
+        voltage_table().lookup(v[i], y);
+
+        an=y[VT_AN];  bn=y[VT_BN];
+        am=y[VT_AM];  bm=y[VT_BM];
+        ah=y[VT_AH];  bh=y[VT_BH];
+    }
+    else
+    {
+        an=voltage_function(VT_AN, v[i]);
+        bn=voltage_function(VT_BN, v[i]);
+        am=voltage_function(VT_AM, v[i]);
+        bm=voltage_function(VT_BM, v[i]);
+        ah=voltage_function(VT_AH, v[i]);
+        bh=voltage_function(VT_BH, v[i]);
+    }
 
     // Ionic Currents
     double I_Na   = gna* (v[i]-vna);    // Sodium current;     uA per cm^2
     double I_K    = gk * (v[i]-vk);     // Potassium current;  uA per cm^2
     double I_Leak = gl * (v[i]-vl);     // Leak current;       uA per cm^2
     
-    m[i+1] =m[i]+ex.deltaT*(am*(1-m[i])-bm*m[i]);   // m: Sodium channel activation
-    h[i+1] =h[i]+ex.deltaT*(ah*(1-h[i])-bh*h[i]);   // h: Sodium channel inactivation
-    n[i+1] =n[i]+ex.deltaT*(an*(1-n[i])-bn*n[i]);   // n: Potassium channel activation
+    if (ex.integrator == INTEGRATOR_EULER)
+    {
+        m[i+1] =m[i]+ex.deltaT*(am*(1-m[i])-bm*m[i]);   // m: Sodium channel activation
+        h[i+1] =h[i]+ex.deltaT*(ah*(1-h[i])-bh*h[i]);   // h: Sodium channel inactivation
+        n[i+1] =n[i]+ex.deltaT*(an*(1-n[i])-bn*n[i]);   // n: Potassium channel activation
   
-    v[i+1] =v[i]+ex.deltaT*\
-               ( ex.Iapp[i] - (pow(m[i],3)*h[i]* I_Na + pow(n[i],4) * I_K + I_Leak) );  //  (m^3 * h * I_Na) + (n^4 * I_K) 
+        v[i+1] =v[i]+ex.deltaT*\
+                   ( ex.Iapp[i] - (ipow<3>(m[i])*h[i]* I_Na + ipow<4>(n[i]) * I_K + I_Leak) );  //  (m^3 * h * I_Na) + (n^4 * I_K) 
+    }
+    else
+    {
+        m[i+1] = rush_larsen(m[i], am, bm, ex.deltaT);
+        h[i+1] = rush_larsen(h[i], ah, bh, ex.deltaT);
+        n[i+1] = rush_larsen(n[i], an, bn, ex.deltaT);
     
+        // v relaxes to the reversal potential of the conductances held over the step
+        double g_Na = gna*ipow<3>(m[i])*h[i];
+        double g_K  = gk *ipow<4>(n[i]);
+        double g    = g_Na + g_K + gl;
+    
+        v[i+1] = relax(v[i], ex.Iapp[i] + g_Na*vna + g_K*vk + gl*vl, 0, 1/g, ex);
+    }
+
+    Ivgcc[i] = vgcc.I_Ca(i, ex, v[i], ca_VGCC[i]);   // calcium current due to a number (1?) of  VGCCs
+
+    ca_VGCC[i+1] = relax(ca_VGCC[i], flux_VGCC(i), 0, tau_dec, ex);
+}
+
+void bouton_model(int i, EX & ex, double aG_syn, int AP5, int RY) 
+{
+    if ( ! hoisted ) {
+        membrane_model(i, ex);
+    }
     
     // Ca2+ plasma membrane (PM) flux, using tau_decay instead of explicit pump and leak fluxes
     //
     IPump[i] =0;    // Ip*pow(ca_local[i],2)/(pow(ca_local[i],2)+pow(k_pump,2));  // PMCA; uA per cm^2
     ICa_leak[i] =0; // v_leak*(v[i]-vca);                                         // Calcium leak; uA per cm^2  
-    //
-    //  
-    //
-    Ivgcc[i] = vgcc.I_Ca(i, ex.deltaT, v[i], ca_VGCC[i]);   // calcium current due to a number (1?) of  VGCCs
-    
     //
     double fluxRyR=0, fluxVGCC=0, fluxPreNMDAR=0;  // change in concentration due to these channels
     //
@@ -342,12 +448,7 @@ void bouton_model(int i, EX ex, double aG_syn, int AP5, int RY)
     //Note: ACh in NMJ synaptic cleft: 4 x e-6 cm^2/s == 4 x e2 um^2/s == 4 x e5 nm^2/s == 4 x e2 nm^2/ms
     //      Assuming a 50 nm cleft and that t ~ x^2/2D, t = 3.1 us
     //
-    double vgcc_distance  = 0.090; // distance from VGCC to vesicle;  .10 um == 100 nm
-    double nmdaR_distance = 0.030; // distance from nmdaR to vesicle; um
-    // double DCa=0.220;           // diffusion coefficient: 0.220 um^2 /ms; 
-    double DCa=0.050;              // diffusion coefficient: 0.050 um^2/ms   // Nadkarni et al. 2010
-    //                                  
-    // Nadkarni 2012:  50 um^2/s   == 0.05  um^2/ms  
+    // vgcc_distance, nmdaR_distance, DCa:  see the class constants
     //
     // See Sterratt (2011) p 138:  Using F etc. we get the rate of change in [Ca], i.e. the flux.
     //
@@ -355,24 +456,22 @@ void bouton_model(int i, EX ex, double aG_syn, int AP5, int RY)
     // 
     // Change in [Ca2+] at distance vgcc_distance form the VGCCs due to the influx of Ca2+ ions from the cluster of VGCCs.
     // Key point:  Surface area is 1 (enough area for one cluster of VGCCs); and here we divide by distance, not volume.
-    fluxVGCC = (-Ivgcc[i] * 1)/(2 * Fmicro * DCa * vgcc_distance); 
-    
-    ca_VGCC[i+1] = ca_VGCC[i] + ex.deltaT * (fluxVGCC - ((ca_VGCC[i] - 0)/tau_dec));
+    fluxVGCC = flux_VGCC(i);   // ca_VGCC[i+1]:  see membrane_model()
      
     // Calcium influx from RyR.   The release of Ca into a confined space between
     // the cell membrane and the SR can result in a much higher local [Ca] than is
     // predicted by a spatially homogeneous model.   Keener and Sneyd 1998, p181.
     //
     if (RY==0)  // if no RyR blocker
-    {                                                          // ex.beg_pad (padding) is in milliseconds
-       double delay_time_steps = (ex.beg_pad + 1.0)/ex.deltaT; // delay is very short, 1 ms??
+    {
+       double delay_time_steps = delay_steps(ex);
        
        if (i > delay_time_steps) 
        {
          fluxRyR = 1 * er.ryr.Jcicr(i, ca_local[(int)(i - delay_time_steps)], \
                                      er.cer[(int)(i - delay_time_steps)]); 
          
-         ca_RyR[i+1]  = ca_RyR[i] + ex.deltaT*(fluxRyR - ((ca_RyR[i] - 0)/tau_dec)); 
+         ca_RyR[i+1]  = relax(ca_RyR[i], fluxRyR, 0, tau_dec, ex); 
        }
        else
        {
@@ -391,12 +490,12 @@ void bouton_model(int i, EX ex, double aG_syn, int AP5, int RY)
     
     if (AP5 == 0)  
     {    
-      double delay_time_steps = (ex.beg_pad+1.0)/ex.deltaT;   // delay is probably ~1 ms or 20 dt steps
+      double delay_time_steps = delay_steps(ex);
      
       double temp = 0; 
       if (i > delay_time_steps) {
         int gluTimePoint = (int) i - delay_time_steps;
-        temp = nmdaR.I_Ca(i, ex.deltaT, ves.G_syn[gluTimePoint], v[i], ca_PreNMDAR[i]);
+        temp = nmdaR.I_Ca(i, ex, ves.G_syn[gluTimePoint], v[i], ca_PreNMDAR[i]);
       }
       
       Inmda[i]    = temp;           // for plotting calcium current
@@ -408,26 +507,74 @@ void bouton_model(int i, EX ex, double aG_syn, int AP5, int RY)
 
       fluxPreNMDAR = (-Inmda_Ca[i] * 1)/(2*Fmicro * DCa * nmdaR_distance); 
 
-      ca_PreNMDAR[i+1] = ca_PreNMDAR[i] + ex.deltaT*(fluxPreNMDAR - ((ca_PreNMDAR[i] - 0)/tau_dec)); 
-
-      ca_PreNMDAR_mean[i+1] += ca_PreNMDAR[i+1];  // calculate mean at end of simulation
+      ca_PreNMDAR[i+1] = relax(ca_PreNMDAR[i], fluxPreNMDAR, 0, tau_dec, ex); 
     }
    
     
     // ============ divide local Ca fluxes by bouton_volume to approximate global [Ca] =============
                                                                                                                   
-    ca_local[i+1] = ca_local[i] + ex.deltaT * \
-                    (fluxVGCC + fluxRyR + fluxPreNMDAR  - (ca_local[i] - c_rest_bouton)/tau_dec);   
-                                                               
+    ca_local[i+1] = relax(ca_local[i], fluxVGCC + fluxRyR + fluxPreNMDAR, c_rest_bouton, tau_dec, ex);
                                   
-    ca_global[i+1]= ca_global[i]+ex.deltaT * ( (number_of_VGCCs * fluxVGCC/bouton_volume) + \
-                                              fluxRyR/bouton_volume + \
-                                              (number_of_preNMDARs * fluxPreNMDAR/bouton_volume)  \
-                 - (ca_global[i]-c_rest_bouton)/tau_dec);
+    ca_global[i+1]= relax(ca_global[i], (number_of_VGCCs * fluxVGCC/bouton_volume) + \
+                                        fluxRyR/bouton_volume + \
+                                        (number_of_preNMDARs * fluxPreNMDAR/bouton_volume), 
+                          c_rest_bouton, tau_dec, ex);
         
     ves.release(i, ex, v[i], vr, ca_local[i], AP5);
  }
  
 };    
 
- 
\ No newline at end of file
+ 
+
+//! Trial-invariant drive of the bouton
+/*!
+The membrane potential, the gates, Ivgcc and ca_VGCC depend on the stimulus 
+ex.Iapp only (see Bouton::membrane_model()), so they are the same in every 
+trial of both conditions.  sim() integrates them once per experiment, here, 
+and with ex.hoist the bouton of every worker shares these traces, read only,
+and integrates just what is downstream of them:  ca_RyR, ca_PreNMDAR, 
+ca_local, the sensor and G_syn, then the spine and the astrocyte.  The same
+equations in the same order, so the results are the same bit for bit.
+
+The traces keep all ex.tn time points, even if those of the trials are rings.
+*/
+class Drive
+{
+public:
+
+Trace v, m, h, n, mc, Ivgcc, ca_VGCC;
+
+Drive(EX & ex)
+{
+    Bouton<Vesicle_Hill> b;   // just its membrane, whatever the sensor
+
+    v = b.v = Trace(ex.tn);
+    m = b.m = Trace(ex.tn);
+    h = b.h = Trace(ex.tn);
+    n = b.n = Trace(ex.tn);
+    Ivgcc   = b.Ivgcc   = Trace(ex.tn);
+    ca_VGCC = b.ca_VGCC = Trace(ex.tn);
+    
+    b.vgcc = VGCC_bouton(ex.tn, ex.vca);
+    mc = b.vgcc.mc;
+    
+    b.set_membrane(ex.tn);
+    
+    for(int i=1; i <= ex.tn; ++i) {
+        b.membrane_model(i, ex);
+    }
+}
+};
+
+
+template <class Vesicle>
+void Bouton<Vesicle>::share(Drive & d)
+{
+    v = d.v;  m = d.m;  h = d.h;  n = d.n;
+    vgcc.mc = d.mc;
+    Ivgcc   = d.Ivgcc;
+    ca_VGCC = d.ca_VGCC;
+    
+    hoisted = 1;
+}
@@ -21,6 +21,11 @@ double V_T = 16.13 * log(Mg/3.37);
 #include "utilities.h"
 #endif
 
+#ifndef _vtable_h_included_
+#define _vtable_h_included_
+#include "vtable.h"
+#endif
+
 class PreNMDAR
 {    
     /* 
@@ -44,11 +49,14 @@ class PreNMDAR
     static constexpr double gNMDA=0.3;    //  .21    0.7 * 10; 
                                       //  max conductance=0.7 for excitatory neuron, p382 of Traub 1994, 
     static constexpr double Mg=2.0;       //  extracellular [Mg++] in mM
+    static constexpr double K_Mg=3.57;    //  mM, of the Mg2+ block
+    static constexpr int    n_inact=4;        //  Ca2+ dependent inactivation, see I_Ca()
+    static constexpr double Kd_inact=10000;   //  nM,  or 10 uM
     //double Vca;                     //  E_Ca ~ 120 mV
                                       //  See struct Ex in utilities.h 
     double Vca=130.65;                //  130.65 if [Ca]ex = 3 mM as in McGuinness 2010, 
                                       //  used Nernst Eq., 125 if 2 mM 
-    double * syn;                    
+    Trace syn;                    
     
 PreNMDAR() 
 {
@@ -59,18 +67,33 @@ PreNMDAR(int tn, double v_ca)
 {
    Vca=v_ca;
 
-   syn = init_double(tn);
+   syn = Trace(tn);
+}
+
+// syn is read one step before it is first written, so clear all of it, 
+// including what a ring trace kept from the previous trial.
+void set()
+{
+   for(int i=0; i < syn.length; ++i) {
+      syn.data[i]=0;
+   }
 }
 
-double I_Ca(int i, double deltaT, double glu, double Vm, double ca)
+double I_Ca(int i, EX & ex, double glu, double Vm, double ca)
 {
    // Mg2+ blocks channel unless membrane is depolarised
-   double B =  1/( 1 + exp(-0.062 * Vm) * (Mg/3.57) );     // 3.57 mM     // p163 Ermentrout,2010  
+   double unblock = ex.tables ? voltage_table()(VT_MG, Vm) : exp(-0.062 * Vm);
+   double B =  1/( 1 + unblock * (Mg/K_Mg) );     // p163 Ermentrout,2010  
    
    // printf("BR 61 \n");
    // larger a_r and a_d cause fast changing conductance, 
    // syn[i] = fraction of open channels at time t=i 
-   syn[i+1] = syn[i] + deltaT * (  a_r * glu * (1 - syn[i]) - a_d * syn[i]);
+   if (ex.integrator == INTEGRATOR_EULER) {
+      syn[i+1] = syn[i] + ex.deltaT * (  a_r * glu * (1 - syn[i]) - a_d * syn[i]);
+   }
+   else {
+      syn[i+1] = rush_larsen(syn[i], a_r * glu, a_d, ex.deltaT);
+   }
    
    /* 
      True [Ca] in microdomain near preNMDARs would be much higher than 
@@ -79,8 +102,7 @@ double I_Ca(int i, double deltaT, double glu, double Vm, double ca)
      Below: Hill equation based Ca2+ sensor for Ca2+ dependent inactivation 
      of preNMDARs.  Without inactivation, [Ca] would get too high.
    */
-   double n = 4, Kd = 10000;     // nM,  or 10 uM
-   double sensor = pow(Kd,n)/(pow(Kd,n) + pow(ca,n));     
+   double sensor = hill_inhibition<n_inact>(ca, Kd_inact);     
                                                                  
    double I_Ca = gNMDA * sensor * syn[i] * B * (Vm - Vca); // Vca=125  if [Ca]ex=2 mM, ~130 if 3 mM
       
@@ -102,6 +124,8 @@ public:
     //
     static constexpr double v_half=-17;       // Half-activation voltage for wild type mice; mV; Ishikawa (2005)
     static constexpr double slope_factor=8.4; // Slope factor for wild type mice; mV; Ishikawa (2005)
+    static constexpr int    n_inact=2;        // Ca2+ dependent inactivation, see I_Ca()
+    static constexpr double Kd_inact=2000;    // nM
     
     static constexpr double tau_mc=10;       // Tewari 2012b, the LTP paper;   Ishikawa et al. 2005 
 
@@ -148,7 +172,7 @@ public:
                                    // 400 /um^2 ==> 400e8, or 40e7
 
     double   gc;     // Calcium channel conductance density;  mS / cm^2
-    double * mc;     // VGCC gating variable
+    Trace mc;     // VGCC gating variable
     
    
     // see book by Liu2012,  p141:  uses HH formalism by Chay and Keizer
@@ -160,28 +184,41 @@ VGCC_bouton()
 };
 
 
+// tn=0:  no mc of its own, it is that of a Drive (see Bouton::share()).
 VGCC_bouton(int tn, double v_ca) 
 { 
     Vca=v_ca;
     gc= g_ca * rho_ca;    // max single channel conductance * channel density
     
-    mc=init_double(tn); // VGCC gating variable for calcium channel
-    mc[1]=0;             
+    if (tn > 0) {
+       mc=Trace(tn); // VGCC gating variable for calcium channel
+       mc[1]=0;             
+    }
 };
 
 
-double I_Ca(int i, double deltaT, double v, double ca_VGCC) 
+// Initial condition for each trial;  a ring trace overwrites mc[1].
+void set()
 {
-   double mcinf=1/(1+exp((v_half-v)/slope_factor));   // current activation 
-    
-   mc[i+1]=mc[i]+deltaT*((mcinf - mc[i])/tau_mc);     // VGCC gating variable tau_mc ????
+    mc[1]=0;
+}
 
-   double n = 2, Kd = 2000;
-   
-   double sensor = pow(Kd,n)/(pow(Kd,n) + pow(ca_VGCC,n));  // Ca2+ dependent inactivation
+
+double I_Ca(int i, EX & ex, double v, double ca_VGCC) 
+{
+   double mcinf = ex.tables ? voltage_table()(VT_MCINF, v) : 1/(1+exp((v_half-v)/slope_factor));   // current activation 
+    
+   if (ex.integrator == INTEGRATOR_EULER) {
+      mc[i+1]=mc[i]+ex.deltaT*((mcinf - mc[i])/tau_mc);     // VGCC gating variable tau_mc ????
+   }
+   else {
+      mc[i+1]=relax(mc[i], mcinf/tau_mc, 0, tau_mc, ex);
+   }
+
+   double sensor = hill_inhibition<n_inact>(ca_VGCC, Kd_inact);  // Ca2+ dependent inactivation
    
    // equations due to Erler 2004, except sensor has been added. 
-   double I_Ca = gc * sensor * pow(mc[i],2) * (v-Vca);  // VGCC current;  uA per cm**2
+   double I_Ca = gc * sensor * ipow<2>(mc[i]) * (v-Vca);  // VGCC current;  uA per cm**2
    
    return I_Ca;
 }
@@ -0,0 +1,227 @@
+//! Result cache
+/*!
+  With cache=dir on the command line (ex.cache), sim() keeps the results of
+  every experiment in dir, and an experiment run again is read from there
+  instead of being simulated.
+
+  An entry is keyed by cache_key(ex):  the text of every field of EX that
+  the results depend on, the calcium sensor model, and STP_VERSION, the
+  build of the program (by default its compile time, so a rebuilt program
+  never reads the results of another).  Its files are named by the 64 bit
+  FNV-1a hash of that text:
+
+    {dir}/{hash}.txt    the key, the bar charts of both conditions and the
+                        mean squared error of mse();
+    {dir}/{hash}-{traces}-trace.bin, -trace_BLOCKER.bin
+                        the traces (TraceSet::save_bin), if the run saved
+                        them;  traces is the hash of the probes, the
+                        ensemble statistics and ex.history, which change
+                        the traces but not the bar charts.
+
+  The key is stored in the entry and compared when it is read, so a hash
+  collision is a miss, not a wrong result.
+
+  Every file is written under a name of its own and then renamed into
+  place, which is atomic, so processes and threads can read and write the
+  same cache at the same time:  a reader sees a whole entry or none.  The
+  trace files are written before {hash}.txt, so an entry whose .txt exists
+  has its traces, unless it was written by a run that saved none;  then a
+  run that needs them simulates and writes the entry again.
+*/
+
+#ifndef _utilities_h_included_
+#define _utilities_h_included_
+#include "utilities.h"
+#endif
+
+#ifndef _save_h_included_
+#define _save_h_included_
+#include "save.h"
+#endif
+
+#ifndef _score_h_included_
+#define _score_h_included_
+#include "score.h"
+#endif
+
+#ifndef _unistd_h_included_
+#define _unistd_h_included_
+#include <unistd.h>
+#endif
+
+#ifndef STP_VERSION
+#define STP_VERSION __DATE__ " " __TIME__
+#endif
+
+// FNV-1a, 64 bit.
+//
+inline uint64_t fnv1a(const std::string & s)
+{
+    uint64_t h = 14695981039346656037ull;
+
+    for(size_t k=0; k < s.size(); ++k) {
+        h = (h ^ (uint8_t) s[k]) * 1099511628211ull;
+    }
+    return h;
+}
+
+// Everything the bar charts of experiment ex depend on, as text.  Not
+// threads, batch and hoist, which leave the results bit for bit the same.
+//
+std::string cache_key(EX & ex)
+{
+    char buf[1024];
+
+    snprintf(buf, sizeof(buf),
+        "version=%s sensor=%s isi=%.17g seconds=%.17g trials=%.17g deltaT=%.17g Tmax=%.17g tn=%d "
+        "beg_pad=%.17g end_pad=%.17g bins=%.17g astro=%d AP5_exp=%d RY_exp=%d "
+        "n1=%.17g n2=%.17g Kd1=%.17g Kd2=%.17g vca=%.17g Ca_ex=%.17g rIP3=%.17g "
+        "seed=%d replay=%d ff=%d integrator=%s tables=%d ssa=%d precision=%.17g min_trials=%d exact=%d rb=%d hazard=%d meanfield=%d",
+        STP_VERSION, sensor_names[ex.sensor], ex.isi, ex.seconds, ex.trials, ex.deltaT, ex.Tmax, ex.tn,
+        ex.beg_pad, ex.end_pad, ex.bins, ex.astro, ex.AP5_exp, ex.RY_exp,
+        ex.n1, ex.n2, ex.Kd1, ex.Kd2, ex.vca, ex.Ca_ex, ex.rIP3,
+        ex.seed, ex.replay, ex.ff, integrator_names[ex.integrator], ex.tables, ex.ssa,
+        ex.precision, ex.min_trials, ex.exact, ex.rb, ex.hazard, ex.meanfield);
+
+    return buf;
+}
+
+// {ex.cache}/{hash}{what}
+//
+std::string cache_path(EX & ex, const char * what)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%016llx", (unsigned long long) fnv1a( cache_key(ex) ));
+
+    return std::string(ex.cache) + "/" + buf + what;
+}
+
+// The file of the traces of condition BLOCKER.
+//
+std::string cache_trace_path(EX & ex, int BLOCKER)
+{
+    std::string tag = std::string(ex.probes ? ex.probes : "") + " history=" + std::to_string(ex.history)
+                    + " ensemble=" + (ex.ensemble ? ex.ensemble : "") + " quantiles=" + (ex.quantiles ? ex.quantiles : "");
+
+    char buf[64];
+    snprintf(buf, sizeof(buf), "-%016llx-%s.bin", (unsigned long long) fnv1a(tag), BLOCKER ? "trace_BLOCKER" : "trace");
+
+    return cache_path(ex, buf);
+}
+
+// A name for writing filename, unique to this process and thread.
+//
+std::string cache_temporary(const std::string & filename)
+{
+    return filename + ".tmp" + std::to_string(getpid()) + "."
+                             + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+}
+
+// Saves traces as the traces of condition BLOCKER of ex.
+//
+void cache_store_traces(EX & ex, int BLOCKER, TraceSet & traces)
+{
+    std::string fn = cache_trace_path(ex, BLOCKER);
+    std::string tmp = cache_temporary(fn);
+
+    if (traces.save_bin(tmp.c_str())) {
+        rename(tmp.c_str(), fn.c_str());
+    }
+    else {
+        remove(tmp.c_str());
+    }
+}
+
+// Reads the traces of condition BLOCKER of ex into traces;  0 if there are none.
+//
+int cache_load_traces(EX & ex, int BLOCKER, TraceSet & traces)
+{
+    return traces.load_bin( cache_trace_path(ex, BLOCKER).c_str() );
+}
+
+static void cache_put_bars(FILE * fp, const char * name, double * bars, EX & ex)
+{
+    fprintf(fp, "%s", name);
+    for(int i=1; i <= ex.bins; ++i) {
+        fprintf(fp, " %.17g", bars[i]);
+    }
+    fprintf(fp, "\n");
+}
+
+// Saves the bar charts of ex, normalised and raw, and their error.
+//
+void cache_store(EX & ex, double * acsf, double * acsf_raw, double * blocker, double * blocker_raw)
+{
+    std::string fn = cache_path(ex, ".txt");
+    std::string tmp = cache_temporary(fn);
+
+    FILE * fp = fopen( tmp.c_str(), "w" );
+
+    if (fp == 0) {
+        fprintf(stderr, "cannot write the cache file %s\n", tmp.c_str());
+        return;
+    }
+    fprintf(fp, "%s\n", cache_key(ex).c_str());
+
+    cache_put_bars(fp, "acsf",        acsf,        ex);
+    cache_put_bars(fp, "acsf_raw",    acsf_raw,    ex);
+    cache_put_bars(fp, "blocker",     blocker,     ex);
+    cache_put_bars(fp, "blocker_raw", blocker_raw, ex);
+
+    fprintf(fp, "mse %.17g\n", mse(acsf, blocker, ex));
+    fclose(fp);
+
+    rename(tmp.c_str(), fn.c_str());
+}
+
+// Reads the bar charts of ex, and their error, from the cache.  Returns 0 if
+// they are not there.
+//
+int cache_load(EX & ex, double * acsf, double * acsf_raw, double * blocker, double * blocker_raw, double & error)
+{
+    FILE * fp = fopen( cache_path(ex, ".txt").c_str(), "r" );
+
+    if (fp == 0) {
+        return 0;
+    }
+    std::string text;
+    char buf[4096];
+    size_t n;
+
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        text.append(buf, n);
+    }
+    fclose(fp);
+
+    std::string key = cache_key(ex) + "\n";
+
+    if (text.compare(0, key.size(), key) != 0) {
+        return 0;   // another experiment with the same hash
+    }
+    const char * p = text.c_str() + key.size();
+
+    double * bars[4] = { acsf, acsf_raw, blocker, blocker_raw };
+    static const char * names[4] = { "acsf ", "acsf_raw ", "blocker ", "blocker_raw " };
+
+    for(int k=0; k < 4; ++k)
+    {
+        if (strncmp(p, names[k], strlen(names[k])) != 0) {
+            return 0;
+        }
+        p += strlen(names[k]);
+
+        for(int i=1; i <= ex.bins; ++i)
+        {
+            char * end;
+            bars[k][i] = strtod(p, &end);
+            if (end == p) {
+                return 0;
+            }
+            p = end;
+        }
+        if (*p++ != '\n') {
+            return 0;
+        }
+    }
+    return sscanf(p, "mse %lf", &error) == 1;
+}
@@ -0,0 +1,327 @@
+//! Ensemble statistics
+/*!
+  The mean and standard deviation over all the trials of a condition of
+  some variables, at every kept time point, without keeping the trials.
+
+  The variables are given as probes are (see probe.h), e.g.
+  ensemble=b_ca_MD:20,b_ca_local,bg@10, and are accumulated in the same
+  condition.  With quantiles=5,50,95 each time point also keeps a quantile
+  sketch, see Quantiles.  They are saved with the traces of the condition
+  as {name}_mean, {name}_sd and {name}_p5 ..., and their times as
+  {name}_mean_t if decimated or windowed.
+
+  Each trial adds to the partial statistics of the worker that runs it,
+  by Welford's update, as it runs or, from a kernel that does not run on a
+  Synapse, once it has run (see add()).  The partials of the blocks of 
+  trials are merged (Chan et al.) in block order, as the bar charts are, so
+  the statistics do not depend on the number of threads.
+
+  sim() always keeps b_ca_PreNMDAR, saved as b_ca_PreNMDAR_mean and _sd.
+*/
+
+#ifndef _probe_h_included_
+#define _probe_h_included_
+#include "probe.h"
+#endif
+
+#ifndef _map_included_
+#define _map_included_
+#include <map>
+#endif
+
+
+//! Quantile sketch
+/*!
+  DDSketch (Masson et al., VLDB 2019):  values are counted in buckets whose
+  bounds grow geometrically by GAMMA, separately for positive and negative
+  values, so any quantile is returned with a relative error of at most
+  ALPHA.  Two sketches merge by adding their counts, exactly.
+*/
+class Quantiles
+{
+public:
+
+static constexpr double ALPHA=0.01;
+static constexpr double GAMMA=(1 + ALPHA)/(1 - ALPHA);
+static constexpr double ZERO=1e-12;   // |x| below this counts as 0
+
+std::map<int, double> pos, neg;   // bucket k:  GAMMA^(k-1) < |x| <= GAMMA^k
+double zero;
+
+Quantiles() { zero=0; }
+
+void add(double x)
+{
+    if (fabs(x) < ZERO) {
+        zero += 1;
+        return;
+    }
+    int k = (int) ceil( log(fabs(x))/log(GAMMA) );
+
+    (x > 0 ? pos : neg)[k] += 1;
+}
+
+void merge(const Quantiles & q)
+{
+    for(auto it = q.pos.begin(); it != q.pos.end(); ++it) {
+        pos[it->first] += it->second;
+    }
+    for(auto it = q.neg.begin(); it != q.neg.end(); ++it) {
+        neg[it->first] += it->second;
+    }
+    zero += q.zero;
+}
+
+// Quantile p (0..1) of the n values added.
+double quantile(double p, double n) const
+{
+    double rank = p*(n - 1), seen=0;
+
+    for(auto it = neg.rbegin(); it != neg.rend(); ++it) {   // most negative first
+        seen += it->second;
+        if (seen > rank) return -value(it->first);
+    }
+    seen += zero;
+    if (seen > rank) return 0;
+
+    for(auto it = pos.begin(); it != pos.end(); ++it) {
+        seen += it->second;
+        if (seen > rank) return value(it->first);
+    }
+    return pos.empty() ? 0 : value(pos.rbegin()->first);
+}
+
+private:
+
+// The value of bucket k, within ALPHA of every value in it.
+static double value(int k)
+{
+    return 2*pow(GAMMA, k)/(GAMMA + 1);
+}
+};
+
+
+class Ensemble
+{
+public:
+
+// One variable:  probe_vars[var] at the time points i.
+struct Stat
+{
+    int var;
+    int decimated;    // 1 if not every time point
+    std::vector<int> i;
+    double n;         // trials
+    std::vector<double> mean, m2;
+    std::vector<Quantiles> q;
+    size_t next;      // in i, during a trial
+};
+
+std::vector<Stat> stats;
+std::vector<double> levels;   // quantiles, 0..1
+
+
+Ensemble(const char * spec, const char * quantiles, EX & ex)
+{
+    Recorder r(spec, ex);   // same syntax, same time points
+
+    for(const char * p = quantiles; p != 0; p = strchr(p, ','))
+    {
+        if (*p == ',') {
+            ++p;
+        }
+        levels.push_back( atof(p)/100 );
+    }
+
+    for(size_t k=0; k < r.probes.size(); ++k)
+    {
+        Probe & probe = r.probes[k];
+        Stat s;
+
+        s.var = probe.var;
+        s.decimated = probe.decimation > 1 || probe.window > 0;
+
+        for(int t=1; t < ex.tn; ++t) {
+            if (probe.keep(t, ex, r.spikeTimes)) {
+                s.i.push_back(t);
+            }
+        }
+        stats.push_back(s);
+    }
+    reset();
+}
+
+// Forget all the trials.
+void reset()
+{
+    for(size_t k=0; k < stats.size(); ++k) {
+        clear(stats[k]);
+    }
+}
+
+void clear(int BLOCKER)
+{
+    for(size_t k=0; k < stats.size(); ++k) {
+        if (probe_vars[stats[k].var].BLOCKER == BLOCKER) {
+            clear(stats[k]);
+        }
+    }
+}
+
+// Start a trial of condition BLOCKER.
+void begin(int BLOCKER)
+{
+    for(size_t k=0; k < stats.size(); ++k)
+    {
+        if (probe_vars[stats[k].var].BLOCKER == BLOCKER) {
+            stats[k].n += 1;
+            stats[k].next = 0;
+        }
+    }
+}
+
+// Adds time point t of the trial running on s, after step t.
+template <class Vesicle>
+void record(Synapse<Vesicle> & s, int t, int BLOCKER)
+{
+    for(size_t k=0; k < stats.size(); ++k)
+    {
+        Stat & st = stats[k];
+
+        if (probe_vars[st.var].BLOCKER != BLOCKER || st.next == st.i.size() || st.i[st.next] != t) {
+            continue;
+        }
+        update(st, st.next++, probe_trace(s, st.var)[t]);
+    }
+}
+
+// Whether var is the only variable of condition BLOCKER, if it has any:  
+// then a kernel that computes var only can add its trials, see add().
+int only(int var, int BLOCKER) const
+{
+    for(size_t k=0; k < stats.size(); ++k)
+    {
+        if (probe_vars[stats[k].var].BLOCKER == BLOCKER && stats[k].var != var) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Adds a trial of condition BLOCKER, run elsewhere, in which variable var,
+// the only one, see only(), was x[t] at time point t.  The same as 
+// recording it with begin() and record(), to the last bit.
+void add(int BLOCKER, int var, const double * x)
+{
+    begin(BLOCKER);
+    
+    for(size_t k=0; k < stats.size(); ++k)
+    {
+        Stat & st = stats[k];
+        
+        if (st.var != var || probe_vars[var].BLOCKER != BLOCKER) {
+            continue;
+        }
+        for(size_t j=0; j < st.i.size(); ++j) {
+            update(st, j, x[st.i[j]]);
+        }
+    }
+}
+
+// Adds the trials of e, which has the same variables.
+void merge(const Ensemble & e)
+{
+    for(size_t k=0; k < stats.size(); ++k)
+    {
+        Stat & a = stats[k];
+        const Stat & b = e.stats[k];
+
+        if (b.n == 0) {
+            continue;
+        }
+        if (a.n == 0) {
+            a.n = b.n;  a.mean = b.mean;  a.m2 = b.m2;  a.q = b.q;
+            continue;
+        }
+        double n = a.n + b.n;
+
+        for(size_t j=0; j < a.i.size(); ++j)
+        {
+            double d = b.mean[j] - a.mean[j];
+
+            a.mean[j] += d*b.n/n;
+            a.m2[j]   += b.m2[j] + d*d*a.n*b.n/n;
+        }
+        for(size_t j=0; j < a.q.size(); ++j) {
+            a.q[j].merge(b.q[j]);
+        }
+        a.n = n;
+    }
+}
+
+// Moves the statistics of condition BLOCKER to traces, see above.
+void collect(int BLOCKER, TraceSet & traces, EX & ex)
+{
+    for(size_t k=0; k < stats.size(); ++k)
+    {
+        Stat & st = stats[k];
+
+        if (probe_vars[st.var].BLOCKER != BLOCKER) {
+            continue;
+        }
+        std::string name = probe_vars[st.var].name;
+        std::vector<double> sd(st.i.size()), t(st.i.size());
+
+        for(size_t j=0; j < st.i.size(); ++j) {
+            sd[j] = (st.n > 1) ? sqrt(st.m2[j]/(st.n - 1)) : 0;
+            t[j]  = ex.t[st.i[j]];
+        }
+
+        std::vector<double> mean = st.mean;
+
+        traces.add( (name + "_mean").c_str(), mean );
+        traces.add( (name + "_sd").c_str(), sd );
+
+        for(size_t l=0; l < levels.size(); ++l)
+        {
+            std::vector<double> x(st.i.size());
+
+            for(size_t j=0; j < st.i.size(); ++j) {
+                x[j] = st.q[j].quantile(levels[l], st.n);
+            }
+            char suffix[32];
+            snprintf(suffix, sizeof(suffix), "_p%g", 100*levels[l]);
+            traces.add( (name + suffix).c_str(), x );
+        }
+
+        if (st.decimated) {
+            traces.add( (name + "_mean_t").c_str(), t );
+        }
+        clear(st);
+    }
+}
+
+private:
+
+// Welford's update of time point j of s with x.
+void update(Stat & st, size_t j, double x)
+{
+    double d = x - st.mean[j];
+
+    st.mean[j] += d/st.n;
+    st.m2[j]   += d*(x - st.mean[j]);
+
+    if ( ! levels.empty() ) {
+        st.q[j].add(x);
+    }
+}
+
+void clear(Stat & s)
+{
+    s.n = 0;
+    s.next = 0;
+    s.mean.assign(s.i.size(), 0);
+    s.m2.assign(s.i.size(), 0);
+    s.q.assign(levels.empty() ? 0 : s.i.size(), Quantiles());
+}
+};
@@ -20,7 +20,7 @@ static constexpr double v_serca =2e-4; // nM/cm^2 ms,   p203 Gabbiani
 static constexpr double k_serca=2000;  // nM,  2 uM on  p203 Gabbiani
 
 
-double * cer;    // ER Calcium concentration
+Trace cer;    // ER Calcium concentration
 
 RyR ryr; 
 
@@ -30,9 +30,9 @@ ER() { ;  }
 
 ER(int tn) 
 {    
-   cer= init_double(tn+2);   // ER Calcium concentration
+   cer= Trace(tn);   // ER Calcium concentration
    
-   ryr = RyR(tn+2);
+   ryr = RyR(tn);
 }
 
 void set(int tn)
@@ -43,5 +43,7 @@ void set(int tn)
     }
     
     cer[1]=c_rest_ER;
+    
+    ryr.set();
 }
 };
\ No newline at end of file
@@ -64,15 +64,15 @@ static constexpr double np=0.7;         // 0.3;
 ////////////////////////////
  
  
-double * p;      // IP3 concentration
-double * q;      // IP3 gating variable
+Trace p;      // IP3 concentration
+Trace q;      // IP3 gating variable
 
 
 
 IP3_Receptor(int tn) {
  
-    p=init_double(tn+2);  // IP3 concentration
-    q=init_double(tn+2);  // IP3 gating variable
+    p=Trace(tn);  // IP3 concentration
+    q=Trace(tn);  // IP3 gating variable
 
     p[1]=160;   // Resting [IP3];  nM
     q[1]=0.22;  // Gating variable for IP3R
@@ -96,10 +96,10 @@ double ip3R(int i, double deltaT, double ca,  double cer, double aGsyn) {
    // jpump: serca pump flux
    // jleak: Calcium leak through ER into cytosol
    // p_glu: IP3 production due to extra-synaptic glutamate
-   double jchan= c1 * v1 * pow(minf,3) * pow(ninf,3) * pow(q[i],3) * (ca - cer);  
+   double jchan= c1 * v1 * ipow<3>(minf) * ipow<3>(ninf) * ipow<3>(q[i]) * (ca - cer);  
    double jpump= 0; // v3*pow(ca,2)/( pow(k3,2)+pow(ca,2)  );                    // no c1 ??
    double jleak= 0; // c1*v2*(ca-cer);  
-   double p_glu= v_glu*pow(aGsyn,np)/( pow(k_glu,np) + pow(aGsyn,np) );  
+   double p_glu= v_glu*hill(aGsyn, k_glu, np);  
    
    // deltaT is applied to ip3 and gate, but not flux
    p[i+1]= p[i]+deltaT*( p_glu -  ( (p[i]-p[1])/tau_ip3) );  // p=Intracellular [IP3]
@@ -110,7 +110,7 @@ double ip3R(int i, double deltaT, double ca,  double cer, double aGsyn) {
 
 double serca(int i, double c) 
 {
-   return  v_serca *pow(c,2)/( pow(K_serca,2)+pow(c,2) );
+   return  v_serca *hill<2>(c, K_serca);
 }
 
 double leak(int i, double c, double cer)
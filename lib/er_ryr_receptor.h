@@ -53,14 +53,46 @@ class RyR
 
 public:
 
-double * J_flux;
+// CICR, see Jcicr()
+//
+static constexpr int n=1;  // Hill coefficient.
+                           // n=1 makes short stubby Ca spikes, as in De Schutter and Smolen 1998 
+                           // n=3 makes sharp tall spikes
+                           // low threshold model:    80nM
+                           // high threshold model:  200nM,  Vmax=3.8 ...
+                        
+// Parameters from De Schutter 1998, Chapter 6, page 3,
+// In Methods of Neuronal Modeling by Koch & Segev.
+//
+// Note change:  multiply by 3
+//
+// double x=1e1;   // == 10
+// double y=10e1;  // == 100
+
+static constexpr double Vcicr    = 5e-6;  // 10^-8 /cm^2 /ms   or 3.8 * 10^-8  /cm^2 /ms     
+static constexpr double tau_cicr = 1.2;   // 1.2 ms
+    
+static constexpr double Kcicr = 0.3;      // 0.3 uM
+static constexpr double KT =    0.2;      // 0.2 uM
+
+Trace J_flux;
 
 
 RyR() { ; }
 
 RyR(int tn) 
 {
-   J_flux = init_double(tn+1);
+   J_flux = Trace(tn);
+}
+
+// J_flux is read one step before it is first written, so clear all of it, 
+// including what a ring trace kept from the previous trial.
+void set()
+{
+   for(int i = 0; i < J_flux.length; ++i)
+   {
+      J_flux.data[i]=0;
+   }
 }
 
 double Jcicr(int i, double ca, double cer) {
@@ -69,32 +101,12 @@ double Jcicr(int i, double ca, double cer) {
     cer = cer/1000;     // Note: [Ca2+]er range is 100 uM to 5 mM
 
      
-    double n=1;         // Hill coefficient.
-                        // n=1 makes short stubby Ca spikes, as in De Schutter and Smolen 1998 
-                        // n=3 makes sharp tall spikes
-                        // low threshold model:    80nM
-                        // high threshold model:  200nM,  Vmax=3.8 ...
-                        
-                        // Parameters from De Schutter 1998, Chapter 6, page 3,
-                        // In Methods of Neuronal Modeling by Koch & Segev.
-                        //
-                        // Note change:  multiply by 3
-                        //
-						// double x=1e1;   // == 10
-                        // double y=10e1;  // == 100
-						
-    double Vcicr    = 5e-6; // 10^-8 /cm^2 /ms   or 3.8 * 10^-8  /cm^2 /ms     
-    double tau_cicr = 1.2;          // 1.2 ms
-    
-    double Kcicr = 0.3;     // 0.3 uM
-    double KT =    0.2;     // 0.2 uM
-      
     // inactivation = K / (K + [Ca])     // see Koch 1989, p 105
     
     double J_infinity = 0;
     
     if (ca > KT) {
-        J_infinity = Vcicr * ( pow(ca,n)/(pow(ca,n) + pow(Kcicr,n)) ) * (cer - ca);  
+        J_infinity = Vcicr * hill<n>(ca, Kcicr) * (cer - ca);  
     }
     
     J_flux[i + 1] = (J_infinity - J_flux[i])/tau_cicr;
@@ -0,0 +1,178 @@
+//! Release probabilities
+/*!
+  With the preNMDARs blocked (AP5) nothing random feeds back into the [Ca]
+  at the vesicle:  RyR only sees ca_local, which only depends on the
+  membrane and on itself.  A sensor without random state of its own (Hill,
+  allosteric) then has the same release rate at every time point of every
+  trial, and the only thing a trial adds is the refractory period:  no
+  release within REFRACTORY ms of the last one.
+
+  Two releases at most REFRACTORY ms apart are impossible, so the releases
+  at the time points j of the last REFRACTORY ms are exclusive events, and
+  the probability of a release at time point i is exactly
+
+    e[i] = p[i] * (1 - sum of e[j])
+
+  with p[i] the probability of the time step out of the refractory period,
+  0 outside the release window.  The mean releases after a spike are then
+  the sum of e[i] over its bin, and with ex.exact sim() gets the bars of
+  such a condition from a single trial, see exact_condition().
+*/
+
+#ifndef _utilities_h_included_
+#define _utilities_h_included_
+#include "utilities.h"
+#endif
+
+#ifndef _deque_included_
+#define _deque_included_
+#include <deque>
+#endif
+
+
+// Whether a sensor without random state has the bars of condition AP5 of ex
+// from the release probabilities of one trial:  ex.exact with the preNMDARs
+// blocked, and not paired, which needs the releases of every trial;  or a 
+// mean field, ex.meanfield, where the trial releases these probabilities,
+// so the glutamate and the preNMDARs see the mean release of a step, and
+// the bars are approximate when the preNMDARs are not blocked.
+//
+inline int exact_condition(EX & ex, double AP5)
+{
+    return ex.meanfield || (ex.exact && AP5 == 1 && ! ex.paired);
+}
+
+
+class ExactRelease
+{
+public:
+
+static constexpr double REFRACTORY=6.34;   // ms, as the sensors have it
+
+// Forget the releases of the last trial.
+void reset()
+{
+    recent.clear();
+}
+
+// Probability e of a release at time t (ms), if the step out of the
+// refractory period releases with probability p.
+double step(double t, double p)
+{
+    while ( ! recent.empty() && t - recent.front().t > REFRACTORY ) {
+        recent.pop_front();
+    }
+    double sum=0;
+
+    for(size_t k=0; k < recent.size(); ++k) {
+        sum += recent[k].e;
+    }
+    double e = p*(1 - sum);
+
+    if (e > 0) {
+        recent.push_back( Release{ t, e } );
+    }
+    return e;
+}
+
+private:
+
+struct Release { double t, e; };
+
+std::deque<Release> recent;   // within REFRACTORY ms of the time point, oldest first
+};
+
+
+//! Release probability of a spike, given the trial so far
+/*!
+  Rao-Blackwellization (ex.rb):  instead of the release event of a spike, 0
+  or 1, its expectation given the trial up to the spike, which has the same
+  mean and a smaller variance.  The release window is shorter than both
+  the refractory period, so it has one release at most, and the delay of
+  the preNMDARs and RyR, so its release does not change its own rates.  The
+  expectation is then 1 - the survival through the window:  the products
+  of 1 - p over its steps, p the step probability out of the refractory
+  period of the releases before the window.  step() returns it step by 
+  step, survival * p, so the bins add it up as they add up the events.
+
+  Only the bars use it;  the sampled events still drive the glutamate and
+  the preNMDARs.
+*/
+class WindowRelease
+{
+public:
+
+double prior;      // time of the last release before the window
+double survival;   // probability of no release in the window so far
+
+void reset()
+{
+    prior=-100;
+    survival=1;
+}
+
+// A window starts;  lastRelease is the last release before it.
+void begin(double lastRelease)
+{
+    prior=lastRelease;
+    survival=1;
+}
+
+// Probability of the first release of the window at time t, the step
+// releasing with probability p.
+double step(double t, double p)
+{
+    if (t - prior <= ExactRelease::REFRACTORY) {
+        return 0;
+    }
+    double e = survival*p;
+
+    survival -= e;
+    return e;
+}
+};
+
+
+//! Release by inverse hazard
+/*!
+  ex.hazard:  instead of a uniform number for every step that may release,
+  to test u < p, one Exp(1) threshold E per release:  the step releases once
+  the hazard summed over the steps since the last release, -log(1 - p) per
+  step, reaches E.  The probability that it has not by step i is then
+  exp(-hazard) = the product of the 1 - p, as with a draw per step, so the
+  releases have the same distribution, from one number per release (and
+  one for the first).  The steps in between, outside the release windows or
+  in the refractory period, add no hazard;  E carries over them, which is
+  exact as the exponential distribution has no memory.
+
+  With ex.paired the threshold is the number of the step that first needs
+  it, so both conditions still draw the same numbers.
+*/
+class HazardRelease
+{
+public:
+
+double threshold;   // E, -1 until the next step that may release draws it
+double hazard;      // summed since the last release
+
+void reset()
+{
+    threshold=-1;
+    hazard=0;
+}
+
+// Whether time point i releases, with probability p.
+int step(int i, double p, Random & rng, EX & ex)
+{
+    if (threshold < 0) {
+        threshold = ex.paired ? -log( rng.at(i) ) : rng.exponential();
+    }
+    hazard -= log1p(-p);
+
+    if (hazard < threshold) {
+        return 0;
+    }
+    reset();
+    return 1;
+}
+};
@@ -1,10 +1,41 @@
+//! Fitting the model to the data
+/*!
+  fit() searches the parameters named in a list, e.g. "n1,Kd1,n2,Kd2", for
+  the smallest mean squared error (see mse() in score.h) of the experiments
+  of the command line against McGuinness 2010, with
+
+    "nm"     Nelder-Mead:  every step evaluates its reflection, expansion and
+             both contractions at the same time, and all the points of a
+             shrink at once;
+    "cmaes"  CMA-ES, Hansen's covariance matrix adaptation:  a generation of
+             4 + 3 ln d candidates, d the number of parameters, at once.
+
+  The sims of the candidates (every experiment and replicate) run at the
+  same time, at most as many as there are worker threads, and their trials
+  share the worker pool as the isis of a sweep do.  The search runs in the unit cube, each parameter mapped
+  linearly onto its range in fit_parameters[].
+
+  The error is a Monte Carlo estimate.  So that two candidates can be told
+  apart by fewer trials than their errors need on their own
+
+  (1) every candidate is run with the same seeds (common random numbers):
+      replicate r of every evaluation uses seed ex.seed + r;
+  (2) an evaluation is the mean of reps replicates, with its standard error;
+      Nelder-Mead stops once the errors of the simplex are within twice that
+      of each other;
+  (3) the search favours points that were lucky with its seeds, so at the
+      end the best few points are run again with fresh seeds, and the one
+      with the smallest error on those is returned.
+
+  Every evaluation is kept in the history, see FitResult, and saved to
+  {out}/fit_history.csv.
+*/
 
 #ifndef _utilities_h_included_
 #define _utilities_h_included_
 #include "utilities.h"
 #endif
 
-
 #ifndef _stdio_h_included_
 #define _stdio_h_included_
 #include <stdio.h>
@@ -15,103 +46,655 @@
 #include "simulation.h"
 #endif
 
-EX fit(double * pr_ACSF_barChart, double * pr_BLOCKER_barChart, EX &ex)
-{
-   // first 10 spikes are estimates based on Fig 10 of McGuinness 2010.
-   //
-   double pr_ACSF_data_1[11]     = { 10000,  100, 120, 120, 120, 120, 120, 120,  120, 120, 120 }; 
-   double pr_BLOCKER_data_1[11]  = { 10000,  100, 120, 120, 120, 120, 120, 120,  120, 120, 120 }; 
-   
-   double pr_ACSF_data_5[11]     = { 10000,  100, 160, 240, 300, 300, 300, 300,  300, 300, 300  }; 
-   double pr_BLOCKER_data_5[11]  = { 10000,  100, 150, 150, 150, 150, 150, 150,  150, 150, 150  }; 
-   
-   double pr_ACSF_data_20[11]    = { 10000,  100, 150, 190, 200, 250, 250, 250,  250, 250, 250 }; 
-   double pr_BLOCKER_data_20[11] = { 10000,  100, 150, 190, 190, 190, 190, 190,  190, 190, 190 }; 
-   
-   double minMSE=100000000;
-   double MSE=0, SE=0;  // mean squared error and squared error
- 
-   double start_n1=4, end_n1=5, stepSize=1.0;
-   
-   double start_choice=3, end_choice=3;
-
-   int maxSpikeNumber= ( sizeof(pr_ACSF_data_1)/sizeof(double) )-1;
-    
-   printf("max spike num %d \n", maxSpikeNumber);
-   
-   EX ex1,ex2,ex3, optimal;
-   
-   buildTrain(ex1);
-   buildTrain(ex2);
-   buildTrain(ex3);
-
-   double n1=0;
-   
-   for(n1=start_n1; n1 <= end_n1; n1 = n1 + stepSize)  
-   { 
-       printf("testing n1=%0.1f \n", n1);
-       
-       for(int choice=start_choice; choice <= end_choice; ++choice) 
-       { 
-         if(choice == 1) {  
-          
-            printf("choice=%d \n", choice);
-            ex1.n1=n1;
-              
-            //sim(pr_ACSF_barChart, pr_BLOCKER_barChart, ex1, 0);
-         }
-         else if(choice == 2) {
-            
-            printf("choice=%d \n", choice);
-            ex2.n1=n1;
-            
-            //sim(pr_ACSF_barChart, pr_BLOCKER_barChart, ex2, 0);
-         }
-         else if(choice == 3) {  
-          
-            printf("choice=%d \n", choice);
-            ex3.n1=n1;   
-            
-            sim(pr_ACSF_barChart, pr_BLOCKER_barChart, ex3, 0);
-         } 
-         else {
-            printf("\n Error: choice not available \n");
-            exit(0);
-         }  
-            
-         // mean squared error for this Hill coefficient n1
-         SE=0;
-         
-         for(int i=1; i <= ex.bins && i <= maxSpikeNumber; ++i) 
-         { 
-            if (choice==1) {
-               SE += pow( 100*(pr_ACSF_barChart[i]     - pr_ACSF_data_1[i])/pr_ACSF_data_1[i], 2); 
-               SE += pow( 100*(pr_BLOCKER_barChart[i]  - pr_BLOCKER_data_1[i])/pr_BLOCKER_data_1[i],   2);
-            }
-            else if (choice==2) {
-               SE += pow( 100*(pr_ACSF_barChart[i]     - pr_ACSF_data_5[i])/pr_ACSF_data_5[i],         2); 
-               SE += pow( 100*(pr_BLOCKER_barChart[i]  - pr_BLOCKER_data_5[i])/pr_BLOCKER_data_5[i],   2);
-            }   
-            else if (choice==3) {
-               SE += pow( 100*(pr_ACSF_barChart[i]     - pr_ACSF_data_20[i])/pr_ACSF_data_20[i], 2); 
-               SE += pow( 100*(pr_BLOCKER_barChart[i]  - pr_BLOCKER_data_20[i])/pr_BLOCKER_data_20[i], 2);
-            }      
-         } 
-      } // end of choices, frequencies 1, 5, 20Hz
-      
-      int sets=6;
-      
-      MSE = SE/(ex.bins*sets);  // * 6 because 3 frequencies, same number of bins, 2 conditions each
-      
-      if (MSE < minMSE) { 
-          minMSE=MSE;
-          optimal.n1 = n1;  
-      }
-      printf("minMSE=%0.3f, MSE=%0.3f:  n1=%0.2f \n", minMSE, MSE, ex.n1);
-   } // end of n1 loop
-      
-   printf("Best MSE=%0.3f,  best n1=%0.3f \n", minMSE, optimal.n1); 
-   
-   return optimal;
+#ifndef _score_h_included_
+#define _score_h_included_
+#include "score.h"
+#endif
+
+#ifndef _algorithm_included_
+#define _algorithm_included_
+#include <algorithm>
+#endif
+
+#ifndef _atomic_included_
+#define _atomic_included_
+#include <atomic>
+#endif
+
+// Parameters fit() can vary, and their ranges.
+//
+struct FitParameter
+{
+    const char * name;
+    double EX::* field;
+    double lo, hi;
+    int sensor;   // the only sensor model that reads it, SENSORS: all of them
+};
+
+static const FitParameter fit_parameters[] = {
+    { "n1",  &EX::n1,  1,   8, SENSOR_HILL },    // Hill coefficient of the release sensor
+    { "Kd1", &EX::Kd1, 1,  50, SENSOR_HILL },    // uM
+    { "n2",  &EX::n2,  1,   8, SENSOR_HILL },    // second sensor
+    { "Kd2", &EX::Kd2, 1, 100, SENSOR_HILL },
+    { "vca", &EX::vca, 100, 150, SENSORS },      // mV, calcium reversal potential
+};
+
+static constexpr int FIT_PARAMETERS = sizeof(fit_parameters)/sizeof(FitParameter);
+
+// The stages of a fit, as in the history.
+enum { FIT_NM, FIT_CMAES, FIT_CHECK, FIT_STAGES };
+
+static const char * fit_stage_names[FIT_STAGES] = { "nm", "cmaes", "check" };
+
+// One evaluation:  point u of the unit cube, its mean squared error over
+// the replicates and the standard error of that mean.
+//
+struct FitEvaluation
+{
+    double u[FIT_PARAMETERS];
+    double mse, se;
+    int stage;
+};
+
+struct FitResult
+{
+    EX best;        // the experiments' EX with the parameters found
+    double mse, se; // of best, from the fresh seeds
+    std::vector<FitEvaluation> history;
+};
+
+
+class Fit
+{
+public:
+
+static constexpr int FINALISTS=3;   // points run again with fresh seeds
+
+std::vector<EX> ex;   // the experiments scored
+int d;                // parameters varied
+int p[FIT_PARAMETERS];   // ... their index in fit_parameters
+int reps;             // replicates per evaluation
+int evaluations;      // budget
+
+std::vector<FitEvaluation> history;
+
+
+Fit(std::vector<EX> & experiments, const char * names, int evaluations_, int reps_)
+{
+    for(size_t k=0; k < experiments.size(); ++k)
+    {
+        if (scored(experiments[k])) {
+            ex.push_back(experiments[k]);
+            ex.back().history = ring_history(ex.back());   // bar charts only
+        }
+    }
+    if (ex.empty()) {
+        fprintf(stderr, "fit:  no isi with data, use 1000, 200 or 50\n");
+        exit(1);
+    }
+
+    d=0;
+
+    for(const char * s = names; s != 0; s = strchr(s, ','))
+    {
+        if (*s == ',') {
+            ++s;
+        }
+        int k=0;
+        while (k < FIT_PARAMETERS && ! (strncmp(s, fit_parameters[k].name, strlen(fit_parameters[k].name)) == 0 &&
+                                        (s[strlen(fit_parameters[k].name)] == ',' || s[strlen(fit_parameters[k].name)] == 0)) ) {
+            ++k;
+        }
+        if (k == FIT_PARAMETERS) {
+            fprintf(stderr, "fit:  unknown parameter %s\n", s);
+            exit(1);
+        }
+        if (fit_parameters[k].sensor != SENSORS && fit_parameters[k].sensor != ex[0].sensor) {
+            fprintf(stderr, "fit:  the %s sensor does not read %s, see fit_params\n", sensor_names[ex[0].sensor], fit_parameters[k].name);
+            exit(1);
+        }
+        p[d++] = k;
+    }
+
+    evaluations = evaluations_;
+    reps = (reps_ < 1) ? 1 : reps_;
+}
+
+// Value of parameter j at coordinate u.
+double value(int j, double u)
+{
+    const FitParameter & f = fit_parameters[p[j]];
+    return f.lo + u*(f.hi - f.lo);
+}
+
+// Coordinate of parameter j in e.
+double coordinate(int j, EX & e)
+{
+    const FitParameter & f = fit_parameters[p[j]];
+    double u = (e.*f.field - f.lo)/(f.hi - f.lo);
+
+    return (u < 0) ? 0 : (u > 1) ? 1 : u;
+}
+
+// e with the parameters at u.
+EX at(const double * u, EX e)
+{
+    for(int j=0; j < d; ++j) {
+        e.*fit_parameters[p[j]].field = value(j, u[j]);
+    }
+    return e;
 }
 
+// Evaluates the points x[0..n-1], all at the same time, with the seeds
+// seed, seed+1, ... seed+reps-1, and adds them to the history.  Sim j is
+// experiment k of replicate r of point i, j = (i*reps + r)*E + k;  as many
+// threads as the pool has workers take the next sim until all have run.
+// Each one's trials go to the pool (sim() cannot run as a task of the pool,
+// it waits for tasks of its own).
+void evaluate(FitEvaluation * x, int n, int stage, int seed)
+{
+    int E = (int) ex.size();
+    int sims = n*reps*E;
+    std::vector<double> err(sims, 0);
+    std::vector<std::thread> runs;
+    std::atomic<int> next(0);
+
+    int threads = shared_pool(ex[0].threads).size();
+
+    for(int t=0; t < threads && t < sims; ++t)
+    {
+        runs.push_back( std::thread( [&]() {
+            for(int j = next++; j < sims; j = next++)
+            {
+                int k = j % E, r = (j/E) % reps, i = j/E/reps;
+
+                EX e = at(x[i].u, ex[k]);
+                e.seed = seed + r;
+
+                double * acsf    = init_double(e.bins);
+                double * blocker = init_double(e.bins);
+
+                sim(acsf, blocker, e, 0);
+                err[j] = mse(acsf, blocker, e);
+
+                delete[] acsf;
+                delete[] blocker;
+            }
+        }));
+    }
+    for(size_t t=0; t < runs.size(); ++t) {
+        runs[t].join();
+    }
+
+    for(int i=0; i < n; ++i)
+    {
+        double sum=0, sum2=0;
+
+        for(int r=0; r < reps; ++r)
+        {
+            double m=0;
+            for(int k=0; k < E; ++k) {
+                m += err[(i*reps + r)*E + k]/E;   // mean over the experiments
+            }
+            sum  += m;
+            sum2 += m*m;
+        }
+        x[i].mse = sum/reps;
+        x[i].se  = (reps > 1) ? sqrt( fmax(sum2 - sum*sum/reps, 0)/(reps-1)/reps ) : 0;
+        x[i].stage = stage;
+
+        history.push_back(x[i]);
+        print(x[i]);
+    }
+}
+
+void print(FitEvaluation & x)
+{
+    printf("fit %4d %-5s", (int) history.size(), fit_stage_names[x.stage]);
+
+    for(int j=0; j < d; ++j) {
+        printf(" %s=%0.4g", fit_parameters[p[j]].name, value(j, x.u[j]));
+    }
+    printf("  MSE=%0.3f +- %0.3f\n", x.mse, x.se);
+}
+
+int spent() { return (int) history.size(); }
+
+
+//! Nelder-Mead
+/*!
+  From the simplex of u0 and u0 + 0.25 along each axis.  Points outside the
+  unit cube are moved onto its surface.  Stops after the budget, when the
+  simplex is smaller than 1e-3, or when the errors at its vertices are the
+  same within the noise.
+*/
+void nelder_mead(const double * u0, int seed)
+{
+    std::vector<FitEvaluation> s(d+1);
+
+    for(int i=0; i <= d; ++i)
+    {
+        for(int j=0; j < d; ++j) {
+            s[i].u[j] = u0[j];
+        }
+        if (i > 0) {
+            s[i].u[i-1] += (u0[i-1] <= 0.75) ? 0.25 : -0.25;
+        }
+    }
+    evaluate(s.data(), d+1, FIT_NM, seed);
+
+    auto lower = [](const FitEvaluation & a, const FitEvaluation & b) { return a.mse < b.mse; };
+
+    while (spent() + 4 <= evaluations)
+    {
+        std::sort(s.begin(), s.end(), lower);
+
+        FitEvaluation & best  = s[0];
+        FitEvaluation & worst = s[d];
+
+        double size=0;
+
+        for(int i=1; i <= d; ++i) {
+            for(int j=0; j < d; ++j) {
+                size = fmax(size, fabs(s[i].u[j] - best.u[j]));
+            }
+        }
+        double noise = 2*sqrt(best.se*best.se + worst.se*worst.se);
+
+        if (size < 1e-3 || (reps > 1 && worst.mse - best.mse < noise)) {
+            break;
+        }
+
+        // reflection, expansion, outside and inside contraction
+        static constexpr double coef[4] = { 1, 2, 0.5, -0.5 };
+        FitEvaluation c[4];
+
+        for(int j=0; j < d; ++j)
+        {
+            double centroid=0;
+            for(int i=0; i < d; ++i) {
+                centroid += s[i].u[j]/d;
+            }
+            for(int m=0; m < 4; ++m) {
+                double u = centroid + coef[m]*(centroid - worst.u[j]);
+                c[m].u[j] = (u < 0) ? 0 : (u > 1) ? 1 : u;
+            }
+        }
+        evaluate(c, 4, FIT_NM, seed);
+
+        FitEvaluation & r = c[0];
+        int shrink=0;
+
+        if (r.mse < best.mse) {
+            worst = (c[1].mse < r.mse) ? c[1] : r;
+        }
+        else if (r.mse < s[d-1].mse) {
+            worst = r;
+        }
+        else if (r.mse < worst.mse) {
+            if (c[2].mse <= r.mse) worst = c[2]; else shrink=1;
+        }
+        else {
+            if (c[3].mse < worst.mse) worst = c[3]; else shrink=1;
+        }
+
+        if (shrink)
+        {
+            if (spent() + d > evaluations) {
+                break;
+            }
+            for(int i=1; i <= d; ++i) {
+                for(int j=0; j < d; ++j) {
+                    s[i].u[j] = best.u[j] + 0.5*(s[i].u[j] - best.u[j]);
+                }
+            }
+            evaluate(&s[1], d, FIT_NM, seed);
+        }
+    }
+}
+
+
+//! CMA-ES
+/*!
+  (mu/mu_w, lambda)-CMA-ES with the default parameters of Hansen, "The CMA
+  evolution strategy:  a tutorial" (2016), from mean u0 and step size 0.3.
+  Samples outside the unit cube are mirrored back into it, and enter the
+  update where they were evaluated.  Stops after the budget or when the
+  step size falls below 1e-3.
+*/
+void cmaes(const double * u0, int seed)
+{
+    const int N = FIT_PARAMETERS;
+
+    int lambda = 4 + (int) (3*log((double) d));
+    int mu = lambda/2;
+
+    std::vector<double> w(mu);
+    double wsum=0, w2sum=0;
+
+    for(int i=0; i < mu; ++i) {
+        w[i] = log(mu + 0.5) - log(i + 1.0);
+        wsum += w[i];
+    }
+    for(int i=0; i < mu; ++i) {
+        w[i] /= wsum;
+        w2sum += w[i]*w[i];
+    }
+    double mueff = 1/w2sum;
+
+    double cc = (4 + mueff/d)/(d + 4 + 2*mueff/d);
+    double cs = (mueff + 2)/(d + mueff + 5);
+    double c1 = 2/((d + 1.3)*(d + 1.3) + mueff);
+    double cmu = fmin(1 - c1, 2*(mueff - 2 + 1/mueff)/((d + 2)*(d + 2) + mueff));
+    double damps = 1 + 2*fmax(0, sqrt((mueff - 1)/(d + 1)) - 1) + cs;
+    double chiN = sqrt((double) d)*(1 - 1.0/(4*d) + 1.0/(21*d*d));
+
+    double m[N], pc[N], ps[N], C[N][N], B[N][N], D[N];
+    double sigma=0.3;
+
+    for(int j=0; j < d; ++j)
+    {
+        m[j]=u0[j];  pc[j]=0;  ps[j]=0;  D[j]=1;
+        for(int k=0; k < d; ++k) {
+            C[j][k] = B[j][k] = (j == k);
+        }
+    }
+
+    Random rng(seed, 0, 0, RNG_FIT);
+
+    std::vector<FitEvaluation> x(lambda);
+    std::vector<std::vector<double> > y(lambda, std::vector<double>(N));
+
+    for(int generation=1; spent() + lambda <= evaluations; ++generation)
+    {
+        for(int i=0; i < lambda; ++i)
+        {
+            double z[N], bdz[N];
+
+            for(int j=0; j < d; j += 2) {   // Box-Muller
+                double a = sqrt(-2*log(rng.uniform())), b = 2*PI*rng.uniform();
+                z[j] = a*cos(b);
+                if (j+1 < d) z[j+1] = a*sin(b);
+            }
+            for(int j=0; j < d; ++j) {
+                bdz[j]=0;
+                for(int k=0; k < d; ++k) {
+                    bdz[j] += B[j][k]*D[k]*z[k];
+                }
+            }
+            for(int j=0; j < d; ++j)
+            {
+                double u = fmod(fabs(m[j] + sigma*bdz[j]), 2.0);   // mirrored
+
+                x[i].u[j] = (u > 1) ? 2 - u : u;
+            }
+        }
+        evaluate(x.data(), lambda, FIT_CMAES, seed);
+
+        std::vector<int> rank(lambda);
+        for(int i=0; i < lambda; ++i) {
+            rank[i]=i;
+        }
+        std::sort(rank.begin(), rank.end(), [&](int a, int b) { return x[a].mse < x[b].mse; });
+
+        double ymean[N];
+
+        for(int j=0; j < d; ++j) {
+            ymean[j]=0;
+        }
+        for(int i=0; i < lambda; ++i) {
+            for(int j=0; j < d; ++j) {
+                y[i][j] = (x[i].u[j] - m[j])/sigma;
+            }
+        }
+        for(int i=0; i < mu; ++i) {
+            for(int j=0; j < d; ++j) {
+                ymean[j] += w[i]*y[rank[i]][j];
+            }
+        }
+        for(int j=0; j < d; ++j) {
+            m[j] += sigma*ymean[j];
+        }
+
+        // C^-1/2 ymean = B D^-1 B' ymean
+        double t[N], invsqrt[N];
+
+        for(int k=0; k < d; ++k) {
+            t[k]=0;
+            for(int j=0; j < d; ++j) {
+                t[k] += B[j][k]*ymean[j];
+            }
+            t[k] /= D[k];
+        }
+        double psnorm=0;
+
+        for(int j=0; j < d; ++j)
+        {
+            invsqrt[j]=0;
+            for(int k=0; k < d; ++k) {
+                invsqrt[j] += B[j][k]*t[k];
+            }
+            ps[j] = (1 - cs)*ps[j] + sqrt(cs*(2 - cs)*mueff)*invsqrt[j];
+            psnorm += ps[j]*ps[j];
+        }
+        psnorm = sqrt(psnorm);
+
+        int hsig = psnorm/sqrt(1 - pow(1 - cs, 2*generation))/chiN < 1.4 + 2.0/(d + 1);
+
+        for(int j=0; j < d; ++j) {
+            pc[j] = (1 - cc)*pc[j] + hsig*sqrt(cc*(2 - cc)*mueff)*ymean[j];
+        }
+
+        for(int j=0; j < d; ++j) {
+            for(int k=0; k < d; ++k)
+            {
+                double rankmu=0;
+                for(int i=0; i < mu; ++i) {
+                    rankmu += w[i]*y[rank[i]][j]*y[rank[i]][k];
+                }
+                C[j][k] = (1 - c1 - cmu)*C[j][k]
+                        + c1*(pc[j]*pc[k] + (1 - hsig)*cc*(2 - cc)*C[j][k])
+                        + cmu*rankmu;
+            }
+        }
+
+        sigma *= exp((cs/damps)*(psnorm/chiN - 1));
+
+        eigen(C, B, D);
+
+        double dmax=0;
+
+        for(int j=0; j < d; ++j) {
+            D[j] = sqrt(fmax(D[j], 1e-20));
+            dmax = fmax(dmax, D[j]);
+        }
+
+        if (sigma*dmax < 1e-3) {
+            break;
+        }
+    }
+}
+
+// Eigenvalues D and eigenvectors, the columns of B, of the symmetric C:  Jacobi rotations.
+void eigen(double C[][FIT_PARAMETERS], double B[][FIT_PARAMETERS], double * D)
+{
+    const int N = FIT_PARAMETERS;
+    double a[N][N];
+
+    for(int j=0; j < d; ++j) {
+        for(int k=0; k < d; ++k) {
+            a[j][k] = C[j][k];
+            B[j][k] = (j == k);
+        }
+    }
+
+    for(int sweep=0; sweep < 50; ++sweep)
+    {
+        double off=0;
+
+        for(int j=0; j < d; ++j) {
+            for(int k=j+1; k < d; ++k) {
+                off += a[j][k]*a[j][k];
+            }
+        }
+        if (off < 1e-30) {
+            break;
+        }
+
+        for(int q=0; q < d; ++q) {
+            for(int r=q+1; r < d; ++r)
+            {
+                if (a[q][r] == 0) {
+                    continue;
+                }
+                double theta = (a[r][r] - a[q][q])/(2*a[q][r]);
+                double t = (theta >= 0 ? 1 : -1)/(fabs(theta) + sqrt(theta*theta + 1));
+                double c = 1/sqrt(t*t + 1), s = t*c;
+
+                for(int k=0; k < d; ++k) {    // a = J' a J
+                    double akq = a[k][q], akr = a[k][r];
+                    a[k][q] = c*akq - s*akr;
+                    a[k][r] = s*akq + c*akr;
+                }
+                for(int k=0; k < d; ++k) {
+                    double aqk = a[q][k], ark = a[r][k];
+                    a[q][k] = c*aqk - s*ark;
+                    a[r][k] = s*aqk + c*ark;
+                }
+                for(int k=0; k < d; ++k) {
+                    double bkq = B[k][q], bkr = B[k][r];
+                    B[k][q] = c*bkq - s*bkr;
+                    B[k][r] = s*bkq + c*bkr;
+                }
+            }
+        }
+    }
+    for(int j=0; j < d; ++j) {
+        D[j] = a[j][j];
+    }
+}
+
+
+// The FINALISTS best points of the search, run again with seeds not used
+// so far;  returns the best of them on those.
+FitEvaluation check(int seed)
+{
+    std::vector<FitEvaluation> sorted = history;
+
+    std::sort(sorted.begin(), sorted.end(), [](const FitEvaluation & a, const FitEvaluation & b) { return a.mse < b.mse; });
+
+    std::vector<FitEvaluation> x;
+
+    for(size_t i=0; i < sorted.size() && (int) x.size() < FINALISTS; ++i)
+    {
+        int seen=0;
+
+        for(size_t k=0; k < x.size() && ! seen; ++k)
+        {
+            double dist=0;
+            for(int j=0; j < d; ++j) {
+                dist = fmax(dist, fabs(x[k].u[j] - sorted[i].u[j]));
+            }
+            seen = dist < 1e-9;
+        }
+        if ( ! seen) {
+            x.push_back(sorted[i]);
+        }
+    }
+    evaluate(x.data(), (int) x.size(), FIT_CHECK, seed);
+
+    int best=0;
+
+    for(size_t i=1; i < x.size(); ++i) {
+        if (x[i].mse < x[best].mse) {
+            best = (int) i;
+        }
+    }
+    return x[best];
+}
+
+// The history as a csv file, one line per evaluation.
+void save(const char * filename)
+{
+    FILE * fp = fopen( filename, "w+" );
+
+    if (fp == 0) {
+        fprintf(stderr, "fit:  cannot write %s\n", filename);
+        return;
+    }
+    fprintf(fp, "evaluation,stage");
+
+    for(int j=0; j < d; ++j) {
+        fprintf(fp, ",%s", fit_parameters[p[j]].name);
+    }
+    fprintf(fp, ",mse,se\n");
+
+    for(size_t i=0; i < history.size(); ++i)
+    {
+        fprintf(fp, "%d,%s", (int) i+1, fit_stage_names[history[i].stage]);
+
+        for(int j=0; j < d; ++j) {
+            fprintf(fp, ",%g", value(j, history[i].u[j]));
+        }
+        fprintf(fp, ",%g,%g\n", history[i].mse, history[i].se);
+    }
+    fclose(fp);
+}
+};
+
+
+// Fits the parameters in names (see fit_parameters) to the data, with
+// method "nm" or "cmaes", in at most evaluations evaluations of reps
+// replicates each, from the parameters of ex[0].  The best EX has the
+// parameters found, the other fields of ex[0].
+//
+FitResult fit(std::vector<EX> & ex, const char * method, const char * names, int evaluations, int reps)
+{
+    Fit f(ex, names, evaluations, reps);
+
+    double u0[FIT_PARAMETERS];
+
+    for(int j=0; j < f.d; ++j) {
+        u0[j] = f.coordinate(j, ex[0]);
+    }
+    int seed = ex[0].seed;
+
+    printf("fit %d parameters by %s, %d evaluations of %d replicates on %d experiments\n",
+           f.d, method, evaluations, f.reps, (int) f.ex.size());
+
+    if (strcmp(method, "nm") == 0) {
+        f.nelder_mead(u0, seed);
+    }
+    else if (strcmp(method, "cmaes") == 0) {
+        f.cmaes(u0, seed);
+    }
+    else {
+        fprintf(stderr, "unknown fit method %s, use nm or cmaes\n", method);
+        exit(1);
+    }
+
+    FitEvaluation best = f.check(seed + f.reps);   // fresh seeds
+
+    std::string fn = std::string(ex[0].out) + "/fit_history.csv";
+    f.save(fn.c_str());
+
+    FitResult result;
+    result.best = f.at(best.u, ex[0]);
+    result.mse = best.mse;
+    result.se = best.se;
+    result.history = f.history;
+
+    printf("fit done after %d evaluations: ", f.spent());
+    f.print(best);
+
+    return result;
+}
+
+// Copies the parameters fit() can vary from "from" to "to".
+//
+void fit_parameters_of(EX & to, EX & from)
+{
+    for(int k=0; k < FIT_PARAMETERS; ++k) {
+        to.*fit_parameters[k].field = from.*fit_parameters[k].field;
+    }
+}
@@ -0,0 +1,78 @@
+//! Hill functions
+/*!
+  Powers and Hill functions of the calcium sensors and receptors:
+
+    ipow<N>(x)                x^N
+    hill<N>(x, K)             x^N / (K^N + x^N)  activation
+    hill_inhibition<N>(x, K)  K^N / (K^N + x^N)  inhibition
+
+  N, a Hill coefficient known at compile time, is a template parameter, and
+  x^N a chain of multiplications (by squaring) instead of a call to pow().
+  The same functions with n as their last argument take a coefficient known
+  only at run time, e.g. ex.n1 that fit() varies:  the chains for n = 0 .. 8,
+  pow() for any other n.
+*/
+
+#ifndef _math_h_included_
+#define _math_h_included_
+#include <math.h>
+#endif
+
+template <int N>
+inline double ipow(double x)
+{
+    return (N % 2 ? x : 1.0) * ipow<N/2>(x*x);
+}
+
+template <>
+inline double ipow<0>(double)
+{
+    return 1;
+}
+
+template <int N>
+inline double hill(double x, double K)
+{
+    double xn = ipow<N>(x);
+    return xn/(ipow<N>(K) + xn);
+}
+
+template <int N>
+inline double hill_inhibition(double x, double K)
+{
+    double Kn = ipow<N>(K);
+    return Kn/(Kn + ipow<N>(x));
+}
+
+
+// x^n, n known at run time.
+inline double ipow(double x, double n)
+{
+    int k = (n >= 0 && n <= 8 && n == (int) n) ? (int) n : -1;
+
+    switch (k)
+    {
+        case 0:  return 1;
+        case 1:  return ipow<1>(x);
+        case 2:  return ipow<2>(x);
+        case 3:  return ipow<3>(x);
+        case 4:  return ipow<4>(x);
+        case 5:  return ipow<5>(x);
+        case 6:  return ipow<6>(x);
+        case 7:  return ipow<7>(x);
+        case 8:  return ipow<8>(x);
+        default: return pow(x, n);
+    }
+}
+
+inline double hill(double x, double K, double n)
+{
+    double xn = ipow(x, n);
+    return xn/(ipow(K, n) + xn);
+}
+
+inline double hill_inhibition(double x, double K, double n)
+{
+    double Kn = ipow(K, n);
+    return Kn/(Kn + ipow(x, n));
+}
@@ -0,0 +1,135 @@
+//! Worker pool
+/*!
+  A fixed set of worker threads shared by every simulation in the process.
+
+  parallel_for(n, fn) hands the task numbers 0..n-1 to the workers, in
+  increasing order, and returns when all of them are done.  The worker number
+  passed to fn is in 0..size()-1, so a caller can keep per-worker state,
+  e.g. one Bouton, Spine and Astro per worker thread.
+
+  Several threads may call parallel_for at the same time; their tasks share
+  the same workers.
+*/
+
+#ifndef _thread_included_
+#define _thread_included_
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+#endif
+
+class Pool
+{
+public:
+
+Pool(int threads)
+{
+    stop=0;
+
+    if (threads < 1) {
+        threads=1;
+    }
+
+    for(int w=0; w < threads; ++w)
+    {
+        workers.push_back( std::thread(&Pool::loop, this, w) );
+    }
+}
+
+~Pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop=1;
+    }
+    cv_work.notify_all();
+
+    for(size_t w=0; w < workers.size(); ++w) {
+        workers[w].join();
+    }
+}
+
+int size() { return (int) workers.size(); }
+
+// Run fn(task, worker) for task = 0..n-1 and wait for all of them.
+void parallel_for(int n, std::function<void(int, int)> fn)
+{
+    if (n < 1) {
+        return;
+    }
+
+    Job job;
+    job.fn=fn;
+    job.n=n;
+    job.next=0;
+    job.done=0;
+
+    std::unique_lock<std::mutex> lock(mtx);
+    jobs.push_back(&job);
+    cv_work.notify_all();
+
+    cv_done.wait(lock, [&job]{ return job.done == job.n; });
+}
+
+
+private:
+
+struct Job
+{
+    std::function<void(int, int)> fn;
+    int n;     // number of tasks
+    int next;  // next task to hand out
+    int done;  // number of tasks finished
+};
+
+std::vector<std::thread> workers;
+std::deque<Job *> jobs;
+
+std::mutex mtx;
+std::condition_variable cv_work;
+std::condition_variable cv_done;
+
+int stop;
+
+void loop(int w)
+{
+    std::unique_lock<std::mutex> lock(mtx);
+
+    for(;;)
+    {
+        cv_work.wait(lock, [this]{ return stop || ! jobs.empty(); });
+
+        if (jobs.empty()) {
+            return;  // stop
+        }
+
+        Job * job = jobs.front();
+        int task  = job->next++;
+
+        if (job->next == job->n) {
+            jobs.pop_front();   // every task of this job has been handed out
+        }
+
+        lock.unlock();
+        job->fn(task, w);
+        lock.lock();
+
+        if (++job->done == job->n) {
+            cv_done.notify_all();
+        }
+    }
+}
+};
+
+
+// The pool shared by all simulations.  The first call fixes the number of
+// threads;  threads <= 0 means one per hardware thread.
+//
+Pool & shared_pool(int threads)
+{
+    static Pool pool( threads > 0 ? threads : (int) std::thread::hardware_concurrency() );
+    return pool;
+}
@@ -0,0 +1,296 @@
+//! Probes
+/*!
+  A probe records one model variable of the last trial of a condition while
+  the trial runs, so only the samples someone asked for are kept and saved.
+
+  Probes are given as a comma separated list of  name[:decimation][@window],
+  e.g.  "bv,bc:20,s_Vm@20",  where
+
+    decimation  keeps every decimation-th time point  (default 1, all of them),
+    window      keeps only the time points within window ms of a spike
+                (default: all time points).
+
+  The names are those of the csv files the variables are saved to, see
+  probe_vars[] below.  Without a list every variable is recorded at full
+  resolution, as save_acsf() used to, unless the experiment is one of a sweep;
+  "none" records nothing.
+*/
+
+#ifndef _synapse_h_included_
+#define _synapse_h_included_
+#include "synapse.h"
+#endif
+
+#ifndef _save_h_included_
+#define _save_h_included_
+#include "save.h"
+#endif
+
+#ifndef _stdlib_h_included_
+#define _stdlib_h_included_
+#include <stdlib.h>
+#endif
+
+#ifndef _string_included_
+#define _string_included_
+#include <string>
+#include <vector>
+#endif
+
+
+// The variables that can be recorded:  csv file name, the condition it is
+// recorded in (0 ACSF, 1 BLOCKER) and whether it is one of the default set.
+// probe_trace() finds them in a synapse.
+//
+struct ProbeVar
+{
+    const char * name;
+    int BLOCKER;
+    int all;       // 1: recorded when there is no list
+};
+
+static ProbeVar probe_vars[] = {
+    { "bv",              0, 1 },
+    { "bc",              0, 1 },
+    { "bg",              0, 1 },
+    { "b_vr",            0, 1 },
+    { "b_ca_Ivgcc",      0, 1 },
+    { "b_ca_Inmda",      0, 1 },
+    { "b_ca_VGCC",       0, 1 },
+    { "b_ca_PreNMDAR",   0, 1 },
+    { "b_ca_MD",         0, 1 },
+    { "b_ca_RyR",        0, 1 },
+    { "b_cer",           0, 1 },
+    { "b_ca_vgcc_ryr",   0, 1 },
+    { "b_ves_P_release", 0, 1 },
+    { "a_ip3",           0, 1 },
+    { "a_ca",            0, 1 },
+    { "a_Gsyn",          0, 1 },
+    { "s_Vm",            0, 1 },
+
+    { "b_ca_MD_BLOCKER",         1, 1 },
+    { "b_ves_P_release_BLOCKER", 1, 1 },
+
+    { "b_ca_local",              0, 0 },
+    { "b_ca_local_BLOCKER",      1, 0 },
+    { "bg_BLOCKER",              1, 0 },
+};
+
+// The trace of variable probe_vars[var] in synapse s.
+//
+template <class Vesicle>
+Trace & probe_trace(Synapse<Vesicle> & s, int var)
+{
+    switch (var)
+    {
+        case  0: return s.B.v;
+        case  1: return s.B.ca_global;
+        case  2: return s.B.ves.G_syn;
+        case  3: return s.B.ves.VR_event;
+        case  4: return s.B.Ivgcc;
+        case  5: return s.B.Inmda;
+        case  6: return s.B.ca_VGCC;
+        case  7: return s.B.ca_PreNMDAR;
+        case  8: return s.B.ves.Ca_MD;
+        case  9: return s.B.ca_RyR;
+        case 10: return s.B.er.cer;
+        case 11: return s.B.ca_VGCC_RyR;
+        case 12: return s.B.ves.P_release;
+        case 13: return s.A.a_ip3;
+        case 14: return s.A.ca;
+        case 15: return s.A.aG_syn;
+        case 16: return s.S.Vm;
+        case 17: return s.B.ves.Ca_MD;
+        case 18: return s.B.ves.P_release_BLOCKER;
+        case 19: return s.B.ca_local;
+        case 20: return s.B.ca_local;
+        default: return s.B.ves.G_syn;
+    }
+}
+
+static constexpr int PROBE_VARS = sizeof(probe_vars)/sizeof(probe_vars[0]);
+
+// The index of variable name in probe_vars[], -1 if there is none.
+//
+inline int probe_var(const std::string & name)
+{
+    for(int v=0; v < PROBE_VARS; ++v) {
+        if (name == probe_vars[v].name) {
+            return v;
+        }
+    }
+    return -1;
+}
+
+
+class Probe
+{
+public:
+
+int var;            // index in probe_vars[]
+int decimation;     // keep every decimation-th time point
+double window;      // ms either side of a spike, 0 means every time point
+int next;           // first spike that may still be within window, see keep()
+
+std::vector<int>    i;   // time points kept
+std::vector<double> x;   // values at those time points
+
+Probe(int v, int d, double w)
+{
+    var=v;
+    decimation=d;
+    window=w;
+    next=0;
+}
+
+// Is time point k kept?   k increases from one call to the next.
+int keep(int k, EX & ex, std::vector<double> & spikeTimes)
+{
+    if ( (k-1) % decimation != 0 ) {
+        return 0;
+    }
+    if (window <= 0) {
+        return 1;
+    }
+
+    while (next < (int) spikeTimes.size() && spikeTimes[next] + window < ex.t[k]) {
+        ++next;
+    }
+    return next < (int) spikeTimes.size() && spikeTimes[next] - window <= ex.t[k];
+}
+
+void clear()
+{
+    i.clear();
+    x.clear();
+    next=0;
+}
+};
+
+
+class Recorder
+{
+public:
+
+std::vector<Probe>  probes;
+std::vector<double> spikeTimes;   // ms
+
+Recorder(const char * spec, EX & ex)
+{
+    for(int k=1; k <= ex.tn; ++k)
+    {
+        if (ex.spikes[k]) {
+            spikeTimes.push_back(ex.t[k]);
+        }
+    }
+
+    if (spec == 0)   // default:  everything, unless this is one of a sweep
+    {
+        for(int v=0; v < PROBE_VARS && ! ex.sweep; ++v) {
+            if (probe_vars[v].all) {
+                probes.push_back( Probe(v, 1, 0) );
+            }
+        }
+        return;
+    }
+
+    std::string list(spec);
+    size_t beg=0;
+
+    while (beg < list.size() && list != "none")
+    {
+        size_t end = list.find(',', beg);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        std::string item = list.substr(beg, end-beg);
+        beg = end+1;
+
+        int    d=1;
+        double w=0;
+
+        size_t at = item.find('@');
+        if (at != std::string::npos) {
+            w = atof(item.c_str() + at + 1);
+            item = item.substr(0, at);
+        }
+        size_t colon = item.find(':');
+        if (colon != std::string::npos) {
+            d = atoi(item.c_str() + colon + 1);
+            item = item.substr(0, colon);
+        }
+
+        int v = probe_var(item);
+
+        if (v < 0 || d < 1) {
+            fprintf(stderr, "unknown probe %s\n", item.c_str());
+            exit(1);
+        }
+        probes.push_back( Probe(v, d, w) );
+    }
+}
+
+// Record the probes of condition BLOCKER at time point k, after step k.
+template <class Vesicle>
+void record(Synapse<Vesicle> & s, int k, int BLOCKER, EX & ex)
+{
+    for(size_t p=0; p < probes.size(); ++p)
+    {
+        Probe & probe = probes[p];
+
+        if (probe_vars[probe.var].BLOCKER == BLOCKER && probe.keep(k, ex, spikeTimes))
+        {
+            probe.i.push_back(k);
+            probe.x.push_back( probe_trace(s, probe.var)[k] );
+        }
+    }
+}
+
+// Overwrite the value recorded at time point k, if there is one.
+void set(const char * name, int k, double value)
+{
+    for(size_t p=0; p < probes.size(); ++p)
+    {
+        Probe & probe = probes[p];
+
+        if (probe_vars[probe.var].name == std::string(name) && ! probe.i.empty() && probe.i[0] == k) {
+            probe.x[0] = value;
+        }
+    }
+}
+
+void clear(int BLOCKER)
+{
+    for(size_t p=0; p < probes.size(); ++p)
+    {
+        if (probe_vars[probes[p].var].BLOCKER == BLOCKER) {
+            probes[p].clear();
+        }
+    }
+}
+
+// Moves the samples of each probe of condition BLOCKER to traces as {name} 
+// and, unless it kept every time point, their times as {name}_t.
+void collect(int BLOCKER, TraceSet & traces, EX & ex)
+{
+    for(size_t p=0; p < probes.size(); ++p)
+    {
+        Probe & probe = probes[p];
+
+        if (probe_vars[probe.var].BLOCKER != BLOCKER) {
+            continue;
+        }
+
+        std::vector<double> t;
+        for(size_t k=0; k < probe.i.size(); ++k) {
+            t.push_back( ex.t[probe.i[k]] );
+        }
+        traces.add(probe_vars[probe.var].name, probe.x);
+
+        if (probe.decimation > 1 || probe.window > 0) {
+            traces.add( (std::string(probe_vars[probe.var].name) + "_t").c_str(), t );
+        }
+        probe.clear();
+    }
+}
+};
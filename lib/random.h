@@ -0,0 +1,179 @@
+//! Counter-based random numbers
+/*!
+  Philox4x32-10, from Salmon et al., "Parallel random numbers: as easy as
+  1, 2, 3", SC 2011.
+
+  The n-th number of a stream is a pure function of the stream's key and n,
+  there is no state carried from one number to the next.  A stream is keyed by
+  (seed, condition, trial, component), so
+
+  (1) any trial can be replayed without generating the numbers of the trials
+      before it,
+  (2) streams of different trials, conditions and components never overlap,
+      whichever thread runs them and in whatever order.
+
+  uniform() hands out numbers from a buffer that is refilled 64 at a time;
+  fill() runs 16 independent Philox blocks side by side so the compiler can
+  vectorise the rounds.
+*/
+
+#ifndef _stdint_h_included_
+#define _stdint_h_included_
+#include <stdint.h>
+#endif
+
+// Components that draw random numbers, one stream each per trial.
+enum { RNG_VESICLE=1, RNG_ASTRO=2, RNG_SPIKES=3, RNG_OTHER=4, RNG_FIT=5 };
+
+class Random
+{
+public:
+
+static constexpr int BLOCKS=16;       // Philox blocks per fill
+static constexpr int N=4*BLOCKS;      // numbers per fill
+
+uint32_t key[2];      // seed and component
+uint32_t trial;       // counter word 2
+uint32_t condition;   // counter word 3
+uint64_t block;       // counter words 0,1:  next Philox block to generate
+
+double buffer[N];
+int next;
+
+
+Random()
+{
+    seed(0, 0, 0, 0);
+}
+
+Random(int s, int cond, int trialNumber, int component)
+{
+    seed(s, cond, trialNumber, component);
+}
+
+// Start the stream for (seed, condition, trial, component) at its first number.
+void seed(int s, int cond, int trialNumber, int component)
+{
+    key[0] = (uint32_t) s;
+    key[1] = (uint32_t) component;
+
+    trial     = (uint32_t) trialNumber;
+    condition = (uint32_t) cond;
+
+    block = 0;
+    next  = N;   // buffer is empty
+}
+
+// Uniform random number in (0,1);  never exactly 0 or 1, so log(u) is finite.
+inline double uniform()
+{
+    if (next == N) {
+        fill();
+    }
+    return buffer[next++];
+}
+
+// Exponential random number, mean 1.
+inline double exponential()
+{
+    return -log( uniform() );
+}
+
+// The n-th number of the stream, without touching the buffer.
+double at(uint64_t n)
+{
+    uint32_t x[4];
+
+    philox( n/4, x );
+
+    return to_double( x[n%4] );
+}
+
+
+private:
+
+static inline double to_double(uint32_t x)
+{
+    return ( (double) x + 0.5 ) * (1.0/4294967296.0);   // (x + 1/2) / 2^32
+}
+
+static inline void mulhilo(uint32_t a, uint32_t b, uint32_t & hi, uint32_t & lo)
+{
+    uint64_t p = (uint64_t) a * (uint64_t) b;
+
+    hi = (uint32_t) (p >> 32);
+    lo = (uint32_t) p;
+}
+
+// One Philox4x32-10 block for counter (n, trial, condition).
+void philox(uint64_t n, uint32_t x[4])
+{
+    uint32_t c0=(uint32_t) n, c1=(uint32_t) (n >> 32), c2=trial, c3=condition;
+    uint32_t k0=key[0], k1=key[1];
+
+    for(int r=0; r < 10; ++r)
+    {
+        uint32_t hi0, lo0, hi1, lo1;
+
+        mulhilo(0xD2511F53u, c0, hi0, lo0);
+        mulhilo(0xCD9E8D57u, c2, hi1, lo1);
+
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+    x[0]=c0;  x[1]=c1;  x[2]=c2;  x[3]=c3;
+}
+
+// Generate the next BLOCKS blocks into buffer, in the same order as at().
+void fill()
+{
+    uint32_t c0[BLOCKS], c1[BLOCKS], c2[BLOCKS], c3[BLOCKS];
+
+    for(int j=0; j < BLOCKS; ++j)
+    {
+        uint64_t n = block + j;
+
+        c0[j] = (uint32_t) n;
+        c1[j] = (uint32_t) (n >> 32);
+        c2[j] = trial;
+        c3[j] = condition;
+    }
+
+    uint32_t k0=key[0], k1=key[1];
+
+    for(int r=0; r < 10; ++r)
+    {
+        for(int j=0; j < BLOCKS; ++j)   // independent blocks:  vectorisable
+        {
+            uint64_t p0 = (uint64_t) 0xD2511F53u * c0[j];
+            uint64_t p1 = (uint64_t) 0xCD9E8D57u * c2[j];
+
+            uint32_t x0 = (uint32_t) (p1 >> 32) ^ c1[j] ^ k0;
+            uint32_t x2 = (uint32_t) (p0 >> 32) ^ c3[j] ^ k1;
+
+            c1[j] = (uint32_t) p1;
+            c3[j] = (uint32_t) p0;
+            c0[j] = x0;
+            c2[j] = x2;
+        }
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+
+    for(int j=0; j < BLOCKS; ++j)
+    {
+        buffer[4*j]   = to_double(c0[j]);
+        buffer[4*j+1] = to_double(c1[j]);
+        buffer[4*j+2] = to_double(c2[j]);
+        buffer[4*j+3] = to_double(c3[j]);
+    }
+
+    block += BLOCKS;
+    next = 0;
+}
+};
@@ -24,6 +24,22 @@
 #include "spine.h"
 #endif
 
+#ifndef _string_included_
+#define _string_included_
+#include <string>
+#include <vector>
+#endif
+
+#ifndef _stdint_h_included_
+#define _stdint_h_included_
+#include <stdint.h>
+#endif
+
+#ifndef _string_h_included_
+#define _string_h_included_
+#include <string.h>
+#endif
+
 
 void save(double * data, int tn, const char * filename)
 {
@@ -51,6 +67,24 @@ void save_bins(double * data, int bins, const char * filename)
     fclose(fp);
 }
 
+void save(Trace & data, int tn, const char * filename)
+{
+    save(data.data, tn, filename);
+}
+
+// Saves all of data, e.g. the samples of a probe.
+void save(std::vector<double> & data, const char * filename)
+{
+    FILE * fp = fopen( filename, "w+" ); // Open file for writing
+    
+    for(size_t i=0; i < data.size(); ++i )
+    {
+        fprintf(fp, "%f,", data[i]);
+    }
+    fprintf(fp, "\n");
+    fclose(fp);
+}
+
 void save_int(int * data, int tn, const char * filename)
 {
     FILE * fp = fopen( filename, "w+" ); // Open file for writing
@@ -66,69 +100,307 @@ void save_int(int * data, int tn, const char * filename)
 
 
 
-void save_acsf(Astro A, Spine S, Bouton B, double * pr_ACSF_barChart, double * pr_ACSF_barChart_raw, EX ex) 
+// Saves the bar charts as {out}/{name}{N}Hz.csv and {out}/{name}.csv, where 
+// out=ex.out (csv) and N=1000/isi, and the same for the _raw bar chart.  In a 
+// sweep only the first, as the experiments would overwrite each other's 
+// {out}/{name}.csv.
+//
+void save_bars(double * barChart, double * barChart_raw, const char * name, EX & ex)
 {
-     save( B.v,         ex.tn, (const char *) "csv/bv.csv" ); 
-     save( B.ca_global, ex.tn, (const char *) "csv/bc.csv"); 
-     save( B.ves.G_syn, ex.tn, (const char *) "csv/bg.csv");
-     
-     save( B.ves.VR_event, ex.tn, (const char *)  "csv/b_vr.csv");
-     
-     save( B.Ivgcc,       ex.tn, (const char *)    "csv/b_ca_Ivgcc.csv"     ); 
-     save( B.Inmda,       ex.tn, (const char *)    "csv/b_ca_Inmda.csv"     ); 
-                 
-     save( B.ca_VGCC,     ex.tn, (const char *)      "csv/b_ca_VGCC.csv"     );
-     save( B.ca_PreNMDAR, ex.tn, (const char *)      "csv/b_ca_PreNMDAR.csv" );
-     save( B.ca_PreNMDAR_mean, ex.tn, (const char *) "csv/b_ca_PreNMDAR_mean.csv" );
-     
-     save( B.ves.Ca_MD,  ex.tn, (const char *) "csv/b_ca_MD.csv");             
-     
-     save( B.ca_RyR, ex.tn, (const char *)     "csv/b_ca_RyR.csv" );
-     save( B.er.cer,    ex.tn, (const char *)  "csv/b_cer.csv" ); 
-     
      char fn[50];
      char fn_raw[50];
      
      int nnn=((int)1000/ex.isi);
-     sprintf(fn,     "csv/pr%dHz.csv", nnn );
-     sprintf(fn_raw, "csv/pr%dHz_raw.csv", nnn );
-                 
-     save_bins( pr_ACSF_barChart,     ex.bins, (const char *)  fn);  
-     save_bins( pr_ACSF_barChart_raw, ex.bins, (const char *)  fn_raw); 
-     save_bins( pr_ACSF_barChart,     ex.bins, (const char *)  "csv/pr.csv"); 
-     save_bins( pr_ACSF_barChart_raw, ex.bins, (const char *)  "csv/pr_raw.csv"); 
-                    
-     save(B.ca_VGCC_RyR,             ex.tn,   (const char *)  "csv/b_ca_vgcc_ryr.csv"); 
-
-     for(int i=1; i <= ex.tn; ++i) { 
-      
-       B.ves.RRP[i] = B.ves.RRP[i]/ex.trials;
+     sprintf(fn,     "%s/%s%dHz.csv", ex.out, name, nnn );
+     sprintf(fn_raw, "%s/%s%dHz_raw.csv", ex.out, name, nnn );
+     
+     save_bins( barChart,     ex.bins, (const char *)  fn);  
+     save_bins( barChart_raw, ex.bins, (const char *)  fn_raw); 
+     
+     if (ex.sweep) {
+        return;
      }
-             
-     save(B.ves.P_release, ex.tn, (const char *)  "csv/b_ves_P_release.csv"); 
      
-     save(A.a_ip3, ex.tn, (const char *)  "csv/a_ip3.csv");
-     save(A.ca, ex.tn,    (const char *)  "csv/a_ca.csv");
-     save(A.aG_syn, ex.tn,(const char *)  "csv/a_Gsyn.csv");  
-     save(S.Vm, ex.tn,    (const char *)  "csv/s_Vm.csv");
+     sprintf(fn,     "%s/%s.csv", ex.out, name );
+     sprintf(fn_raw, "%s/%s_raw.csv", ex.out, name );
+     
+     save_bins( barChart,     ex.bins, (const char *)  fn); 
+     save_bins( barChart_raw, ex.bins, (const char *)  fn_raw); 
+}
+
+
+//! Trace files
+/*!
+The traces of one condition, saved either as csv files, one per variable, 
+or as a single binary file  (Matlab:  load_traces.m).  In a sweep the file 
+names end in {N}Hz, N=1000/isi.
+
+Binary format, all little-endian:
+
+  char[8]   "STPTRACE"
+  uint32    version, 1
+  uint32    M,  number of EX fields
+  M times   char[32] name, zero padded;  float64 value
+  uint32    N,  number of variables
+  N times   char[32] name, zero padded;  uint64 length
+  N arrays  of length float64 values, in the same order as the names
+*/
+class TraceSet
+{
+public:
+
+static constexpr int NAME=32;   // bytes per name in the binary file
+
+std::string suffix;   // {N}Hz in a sweep, so the files of each isi differ
+std::string out;      // output directory, ex.out
+
+std::vector<std::string> fields;   // EX metadata
+std::vector<double>      values;
+
+std::vector<std::string>          names;
+std::vector<std::vector<double> > columns;
+
+TraceSet(EX & ex, int BLOCKER)
+{
+    field("isi",     ex.isi);
+    field("seconds", ex.seconds);
+    field("trials",  ex.trials);
+    field("deltaT",  ex.deltaT);
+    field("Tmax",    ex.Tmax);
+    field("tn",      ex.tn);
+    field("beg_pad", ex.beg_pad);
+    field("end_pad", ex.end_pad);
+    field("bins",    ex.bins);
+    field("avg",     ex.avg);
+    field("astro",   ex.astro);
+    field("AP5_exp", ex.AP5_exp);
+    field("RY_exp",  ex.RY_exp);
+    field("n1",      ex.n1);
+    field("n2",      ex.n2);
+    field("Kd1",     ex.Kd1);
+    field("Kd2",     ex.Kd2);
+    field("vca",     ex.vca);
+    field("seed",    ex.seed);
+    field("history", ex.history);
+    field("BLOCKER", BLOCKER);
+    
+    out = ex.out;
+    
+    if (ex.sweep) {
+        int nnn=((int)1000/ex.isi);
+        suffix = std::to_string(nnn) + "Hz";
+    }
+}
+
+void field(const char * name, double value)
+{
+    fields.push_back(name);
+    values.push_back(value);
+}
+
+// Takes the values of x, leaving x empty.
+void add(const char * name, std::vector<double> & x)
+{
+    names.push_back(name);
+    columns.push_back( std::vector<double>() );
+    columns.back().swap(x);
+}
+
+// Time points 1..tn-1 of x, as save() writes them.
+void add(const char * name, Trace & x, int tn)
+{
+    std::vector<double> column;
+    for(int i=1; i < tn; ++i) {
+        column.push_back(x[i]);
+    }
+    add(name, column);
+}
+
+// Saves {out}/{name}{suffix}.csv for each variable.
+void save_csv()
+{
+    char fn[100];
+    for(size_t k=0; k < names.size(); ++k)
+    {
+        sprintf(fn, "%s/%s%s.csv", out.c_str(), names[k].c_str(), suffix.c_str());
+        save(columns[k], fn);
+    }
+}
+
+// Returns 0 if the file cannot be written.
+int save_bin(const char * filename)
+{
+    FILE * fp = fopen( filename, "wb" );
+    
+    if (fp == 0) {
+        fprintf(stderr, "cannot write %s\n", filename);
+        return 0;
+    }
+    fwrite("STPTRACE", 1, 8, fp);
+    put_uint32(fp, 1);
+    
+    put_uint32(fp, fields.size());
+    for(size_t k=0; k < fields.size(); ++k)
+    {
+        put_name(fp, fields[k]);
+        put_double(fp, &values[k], 1);
+    }
+    
+    put_uint32(fp, names.size());
+    for(size_t k=0; k < names.size(); ++k)
+    {
+        put_name(fp, names[k]);
+        
+        uint64_t len = columns[k].size();
+        put(fp, &len, 8, 1);
+    }
+    
+    for(size_t k=0; k < columns.size(); ++k) {
+        put_double(fp, columns[k].data(), columns[k].size());
+    }
+    int ok = ! ferror(fp);
+    
+    if (fclose(fp) != 0 || ! ok) {
+        fprintf(stderr, "cannot write %s\n", filename);
+        return 0;
+    }
+    return 1;
+}
+
+// Reads a file written by save_bin, in place of the fields and variables.
+// Returns 0, and leaves the set empty, if the file is missing or incomplete.
+int load_bin(const char * filename)
+{
+    FILE * fp = fopen( filename, "rb" );
+    
+    if (fp == 0) {
+        return 0;
+    }
+    fields.clear();  values.clear();
+    names.clear();   columns.clear();
+    
+    char magic[8];
+    uint32_t version=0, M=0, N=0;
+    
+    int ok = fread(magic, 1, 8, fp) == 8 && memcmp(magic, "STPTRACE", 8) == 0
+          && get(fp, &version, 4, 1) && version == 1 && get(fp, &M, 4, 1);
+    
+    for(uint32_t k=0; ok && k < M; ++k)
+    {
+        std::string name;
+        double value=0;
+        ok = get_name(fp, name) && get(fp, &value, 8, 1);
+        
+        fields.push_back(name);
+        values.push_back(value);
+    }
+    
+    ok = ok && get(fp, &N, 4, 1);
+    
+    std::vector<uint64_t> lengths(ok ? N : 0);
+    
+    for(uint32_t k=0; ok && k < N; ++k)
+    {
+        std::string name;
+        ok = get_name(fp, name) && get(fp, &lengths[k], 8, 1);
+        names.push_back(name);
+    }
+    for(uint32_t k=0; ok && k < N; ++k)
+    {
+        columns.push_back( std::vector<double>(lengths[k]) );
+        ok = get(fp, columns[k].data(), 8, lengths[k]);
+    }
+    fclose(fp);
+    
+    if ( ! ok ) {
+        fields.clear();  values.clear();
+        names.clear();   columns.clear();
+    }
+    return ok;
+}
+
+private:
+
+static int little_endian()
+{
+    uint16_t x=1;
+    return *(uint8_t *) &x == 1;
+}
+
+// Writes count items of size bytes each, little-endian.
+static void put(FILE * fp, const void * data, int size, size_t count)
+{
+    if (little_endian()) {
+        fwrite(data, size, count, fp);
+        return;
+    }
+    const uint8_t * p = (const uint8_t *) data;
+    uint8_t item[8];
+    
+    for(size_t k=0; k < count; ++k, p += size)
+    {
+        for(int b=0; b < size; ++b) {
+            item[b] = p[size-1-b];
+        }
+        fwrite(item, size, 1, fp);
+    }
+}
+
+static void put_uint32(FILE * fp, uint32_t x) { put(fp, &x, 4, 1); }
+
+static void put_double(FILE * fp, const double * x, size_t count) { put(fp, x, 8, count); }
+
+static void put_name(FILE * fp, const std::string & name)
+{
+    char buf[NAME];
+    memset(buf, 0, NAME);
+    strncpy(buf, name.c_str(), NAME-1);
+    fwrite(buf, 1, NAME, fp);
+}
+
+// Reads count items of size bytes each, little-endian;  0 if the file ends first.
+static int get(FILE * fp, void * data, int size, size_t count)
+{
+    if (fread(data, size, count, fp) != count) {
+        return 0;
+    }
+    uint8_t * p = (uint8_t *) data;
+    
+    for(size_t k=0; k < count && ! little_endian(); ++k, p += size)
+    {
+        for(int b=0; b < size/2; ++b) {
+            uint8_t t = p[b];  p[b] = p[size-1-b];  p[size-1-b] = t;
+        }
+    }
+    return 1;
+}
+
+static int get_name(FILE * fp, std::string & name)
+{
+    char buf[NAME+1];
+    buf[NAME]=0;
+    
+    if (fread(buf, 1, NAME, fp) != NAME) {
+        return 0;
+    }
+    name = buf;
+    return 1;
+}
+};
+
+
+// The traces are saved by a TraceSet, see sim().
+//
+void save_acsf(double * pr_ACSF_barChart, double * pr_ACSF_barChart_raw, EX & ex) 
+{
+     save_bars( pr_ACSF_barChart, pr_ACSF_barChart_raw, "pr", ex );
 }
 
 
 
-void save_blocker(Bouton B, double * pr_BLOCKER_barChart, double * pr_BLOCKER_barChart_raw, EX ex)
+void save_blocker(double * pr_BLOCKER_barChart, double * pr_BLOCKER_barChart_raw, EX & ex)
 {
-   save(B.ves.Ca_MD,             ex.tn, (const char *)  "csv/b_ca_MD_BLOCKER.csv"); 
-   save(B.ves.P_release_BLOCKER, ex.tn, (const char *)  "csv/b_ves_P_release_BLOCKER.csv"); 
-   char fn[50];
-   char fn_raw[50];
-   int nnn=((int)1000/ex.isi);
-   sprintf(fn,    "csv/prBLOCKER%dHz.csv", nnn );
-   sprintf(fn_raw,"csv/prBLOCKER%dHz_raw.csv", nnn );
-   
-   save_bins( pr_BLOCKER_barChart,      ex.bins, (const char *) fn);
-   save_bins( pr_BLOCKER_barChart_raw,  ex.bins, (const char *) fn_raw);  
-   save_bins( pr_BLOCKER_barChart,      ex.bins, (const char *) "csv/prBLOCKER.csv"); 
-   save_bins( pr_BLOCKER_barChart_raw,  ex.bins, (const char *) "csv/prBLOCKER_raw.csv"); 
+   save_bars( pr_BLOCKER_barChart, pr_BLOCKER_barChart_raw, "prBLOCKER", ex );
 }
 
 
@@ -13,7 +13,11 @@
 #include "math.h"
 #endif
 
-double score(double * pr_ACSF_barChart, double * pr_BLOCKER_barChart, EX ex)
+// Mean squared error, in percent, of the bar charts of experiment ex against 
+// McGuinness 2010 Fig 10.  Only the isis 1000, 200 and 50 ms have data, see 
+// scored();  for any other the error is 0.
+//
+double mse(double * pr_ACSF_barChart, double * pr_BLOCKER_barChart, EX & ex)
 {
    // first 10 spikes are estimates based on Fig 10 of McGuinness 2010.
    double pr_ACSF_data_1[11]     = { 10000,  100, 120, 120, 120, 120, 120, 120,  120, 120, 120 }; 
@@ -55,6 +59,20 @@ double score(double * pr_ACSF_barChart, double * pr_BLOCKER_barChart, EX ex)
   int sets=2;
   
   MSE = SE/(10*sets);  // 10 bins per experiment * 2 conditions
+  
+  return MSE;
+}
+
+// 1 if mse() scores experiment ex.
+//
+int scored(EX & ex)
+{
+  return ex.isi == 1000 || ex.isi == 200 || ex.isi == 50;
+}
+
+double score(double * pr_ACSF_barChart, double * pr_BLOCKER_barChart, EX ex)
+{
+  double MSE = mse(pr_ACSF_barChart, pr_BLOCKER_barChart, ex);
    
   printf("\n\n ===> mean MSE=%0.3f  for isi=%0.0f\n\n", MSE, ex.isi);
   
@@ -34,6 +34,423 @@
 #include "save.h"
 #endif
 
+#ifndef _pool_h_included_
+#define _pool_h_included_
+#include "pool.h"
+#endif
+
+#ifndef _synapse_h_included_
+#define _synapse_h_included_
+#include "synapse.h"
+#endif
+
+#ifndef _probe_h_included_
+#define _probe_h_included_
+#include "probe.h"
+#endif
+
+#ifndef _writer_h_included_
+#define _writer_h_included_
+#include "writer.h"
+#endif
+
+#ifndef _batch_h_included_
+#define _batch_h_included_
+#include "batch.h"
+#endif
+
+#ifndef _cache_h_included_
+#define _cache_h_included_
+#include "cache.h"
+#endif
+
+#ifndef _ensemble_h_included_
+#define _ensemble_h_included_
+#include "ensemble.h"
+#endif
+
+#ifndef _exact_h_included_
+#define _exact_h_included_
+#include "exact.h"
+#endif
+
+// Trials are handed to the worker threads in blocks of this many trials, 
+// which batch_trials() runs side by side.  It must not depend on the number 
+// of threads:  the per block sums are added up in block order, which is what 
+// makes the results independent of it.
+static constexpr int TRIALS_PER_BLOCK=LANES;
+
+
+//! One trial
+/*!
+Runs trial number TrialNumber of experiment ex, in condition BLOCKER, on 
+synapse syn and adds the vesicle release events after spike k to barChart[k].
+If rec is not 0 its probes record the trial as it runs, if ens is not 0 the 
+trial is added to its statistics.
+*/
+template <class Vesicle>
+void trial(Synapse<Vesicle> & syn, EX & ex, int AP5, int RY, int BLOCKER, int TrialNumber, double * barChart, Recorder * rec, Ensemble * ens)
+{
+    Bouton<Vesicle> & B = syn.B;
+    Spine  & S = syn.S;
+    Astro  & A = syn.A;
+    
+    // Every trial has its own random number streams, keyed by (seed, condition,
+    // trial, component), so a trial gives the same result whichever thread 
+    // runs it, and any one trial can be replayed on its own.  ex.paired:  
+    // trial n of both conditions has the same streams, see sim().
+    int condition = ex.paired ? 0 : BLOCKER;
+    
+    B.ves.rng.seed(ex.seed, condition, TrialNumber, RNG_VESICLE);
+    A.rng.seed(    ex.seed, condition, TrialNumber, RNG_ASTRO);
+    
+    B.set(ex.history);   
+    B.ves.set(ex.history); 
+    B.er.set(ex.history); 
+    S.set(ex.history); 
+    A.set(ex.history); 
+    
+    if (ens != 0) {
+        ens->begin(BLOCKER);
+    }
+    
+    int binNumber=0;
+      
+    for(int i=1; i <= ex.tn; ++i) 
+    {  
+        double aG=0;
+     
+        if (ex.astro == 1) {
+            aG=A.aG_syn[i]; 
+        }          
+        B.bouton_model(i, ex, aG, AP5, RY);
+        S.spine_model_1( i, ex.t[i], ex.deltaT, B.ves.lastRelease, B.ves.G_syn[i]);
+        A.astro_model(   i, ex.t[i], ex.deltaT, B.ves.lastRelease, B.ves.G_syn[i]);
+        
+        if (rec != 0 && i < ex.tn) {
+            rec->record(syn, i, BLOCKER, ex);
+        }
+        if (ens != 0 && i < ex.tn) {
+            ens->record(syn, i, BLOCKER);
+        }
+        
+        // count the release events now, a ring trace forgets them
+        binNumber += ex.spikes[i];
+    
+        if (binNumber >= 1 && binNumber <= 10) 
+        {
+           barChart[binNumber] += (double) B.ves.VR_event[i];
+        }
+    }
+}
+
+
+//! Trials of one condition
+/*!
+Runs trials from .. to on the shared worker pool.  Each worker owns a Synapse
+(allocated on first use in syn[worker]) and adds up its release events for
+a block of trials.  The block sums are then added to barChart strictly in 
+block order, so it is bit-identical whatever the number of threads.
+
+The trials of a block run side by side in SIMD lanes if the calcium sensor
+model has a batched kernel (see batch_trials()), one at a time otherwise.
+The probes of rec, if not 0, record trial number to.  If trialCharts is not
+0 the release events of trial n also go to its row n-1, of ex.bins+1 bins.
+If ens is not 0 every trial is added to it:  each worker keeps the partial
+statistics of its block, merged into ens in block order;  the trials run 
+one at a time unless ens keeps b_ca_PreNMDAR only, as the batched kernel 
+does not compute every variable.
+Returns the synapse that ran the last trial.
+*/
+template <class Vesicle>
+Synapse<Vesicle> * trials(Synapse<Vesicle> ** syn, EX & ex, int AP5, int RY, int BLOCKER, double * barChart, Recorder * rec, double * trialCharts, Ensemble * ens, int from, int to)
+{
+    Pool & pool = shared_pool(ex.threads);
+    
+    std::vector<Ensemble *> parts(pool.size(), (Ensemble *) 0);   // per worker
+    
+    for(int w=0; w < pool.size() && ens != 0; ++w) {
+        parts[w] = new Ensemble(*ens);
+        parts[w]->reset();
+    }
+    
+    int trialCount = to;
+    int blocks = (to - from + TRIALS_PER_BLOCK)/TRIALS_PER_BLOCK;
+    
+    if (ex.replay > 0) {
+        blocks=1;    // just trial number ex.replay
+    }
+    
+    std::mutex mtx;
+    std::condition_variable cv;
+    int committed=0;    // blocks added to the sums so far
+    Synapse<Vesicle> * last=0;
+    
+    pool.parallel_for(blocks, [&](int block, int worker)
+    {
+        if (syn[worker] == 0) {
+            syn[worker] = new Synapse<Vesicle>(ex);
+        }
+        Synapse<Vesicle> & s = *syn[worker];
+        
+        Ensemble * part = parts[worker];
+        
+        double * blockChart = init_double(ex.bins);
+        
+        int first = from + block*TRIALS_PER_BLOCK;
+        int end   = first + TRIALS_PER_BLOCK;
+        
+        if (ex.replay > 0) {
+            first = ex.replay;
+            end   = first + 1;
+            trialCount = first;
+        }
+        
+        if (end > trialCount+1) {
+            end = trialCount+1;
+        }
+        
+        // the trials in SIMD lanes, except one recorded by probes
+        int batched = end - first;
+        
+        if (rec != 0 && end == trialCount+1) {
+            --batched;
+        }
+        int lanes_ok = ens == 0 || ens->only(probe_var("b_ca_PreNMDAR"), BLOCKER);
+        
+        if ( ! ex.batch || ! lanes_ok || batched < 2 || ! batch_trials(s, ex, AP5, RY, BLOCKER, first, batched, blockChart, trialCharts, part)) {
+            batched=0;
+        }
+        
+        for(int TrialNumber=first+batched; TrialNumber < end; ++TrialNumber)
+        {
+            Recorder * r = (TrialNumber == trialCount) ? rec : 0;
+            
+            if (trialCharts == 0) {
+                trial(s, ex, AP5, RY, BLOCKER, TrialNumber, blockChart, r, part);
+                continue;
+            }
+            double * row = trialCharts + (TrialNumber-1)*((int) ex.bins+1);
+            
+            trial(s, ex, AP5, RY, BLOCKER, TrialNumber, row, r, part);
+            
+            for(int i=1; i <= ex.bins; ++i) {
+                blockChart[i] += row[i];
+            }
+        }
+        
+        // wait for the blocks before this one
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [&]{ return committed == block; });
+        
+        for(int i=1; i <= ex.bins; ++i) {
+            barChart[i] += blockChart[i];
+        }
+        
+        if (part != 0) {
+            ens->merge(*part);
+            part->reset();
+        }
+        
+        if (block == blocks-1) {
+            last = &s;
+        }
+        
+        ++committed;
+        cv.notify_all();
+        
+        delete[] blockChart;
+    });
+    
+    for(size_t w=0; w < parts.size(); ++w) {
+        delete parts[w];
+    }
+    return last;
+}
+
+
+//! Output of one condition
+/*!
+The writer thread saves copies of the bar charts and the traces, and then 
+deletes traces, while the caller goes on with the next condition.  If 
+keep, the traces go into the result cache as well (see cache.h).
+*/
+void save_output(EX & ex, int BLOCKER, TraceSet * traces, double * chart, double * chart_raw, int keep)
+{
+    std::vector<double> bars(chart, chart + (int) ex.bins + 1);
+    std::vector<double> bars_raw(chart_raw, chart_raw + (int) ex.bins + 1);
+    
+    output_writer().submit( [=]() mutable 
+    {
+       if (traces->names.empty()) {
+          ;   // no probes
+       }
+       else if (ex.csv) {
+          traces->save_csv();
+       }
+       else {
+          std::string fn = traces->out + (BLOCKER ? "/trace_BLOCKER" : "/trace") + traces->suffix + ".bin";
+          traces->save_bin( fn.c_str() );
+       }
+       if (keep) {
+          cache_store_traces(ex, BLOCKER, *traces);
+       }
+       delete traces;
+       
+       if ( ! BLOCKER) {
+          save_acsf(bars.data(), bars_raw.data(), ex);     
+       }
+       else {            
+          save_blocker(bars.data(), bars_raw.data(), ex);
+       }
+    });
+}
+
+
+//! Confidence interval of the bars
+/*!
+The largest half width of the 95% confidence intervals of the mean releases 
+per spike, over the first n rows of trialCharts (see trials()).  Two 
+releases and two failures are added to each bar (Agresti-Coull), so a bar
+of n zeros still has an interval of some width.
+*/
+double confidence(double * trialCharts, int n, EX & ex)
+{
+    int bins = (int) ex.bins;
+    double width=0;
+    
+    for(int i=1; i <= bins; ++i)
+    {
+        double s=2, s2=2;
+        
+        for(int k=0; k < n; ++k) {
+            double x = trialCharts[k*(bins+1) + i];
+            s  += x;
+            s2 += x*x;
+        }
+        double mean = s/(n+4);
+        double var  = fmax(s2/(n+4) - mean*mean, 0);
+        
+        width = fmax(width, 1.96*sqrt(var/(n+4)));
+    }
+    return width;
+}
+
+
+//! Paired difference of the conditions
+/*!
+With ex.paired trial n of the blocker condition draws the same random numbers
+as trial n of ACSF (common random numbers):  the same streams, and the release
+draws keyed by time step, so the two stay in step however their releases
+differ.  The trials are then pairs, and the difference of the conditions is
+estimated from the differences of the pairs, whose variance is smaller than
+the sum of the variances of the two conditions when they are correlated.
+
+Prints, and if save_data saves as {out}/prDIFF{N}Hz.csv, the mean of 
+blocker - ACSF release per spike, and its standard error (_se.csv), from
+the first n rows of trialCharts, one row of ex.bins+1 per trial for each 
+condition.  Also prints the standard error of independent conditions with 
+the same trials.
+*/
+void paired_difference(double * acsf, double * blocker, int n, EX & ex, int save_data)
+{
+    int bins = (int) ex.bins;
+    
+    std::vector<double> diff(bins+1, 0), se(bins+1, 0);
+    double ratio=0;
+    
+    printf(" paired trials, release blocker - ACSF, isi=%0.0f:\n", ex.isi);
+    
+    for(int i=1; i <= bins; ++i)
+    {
+        double sa=0, sb=0, sd=0, saa=0, sbb=0, sdd=0;
+        
+        for(int k=0; k < n; ++k)
+        {
+            double a = acsf[k*(bins+1) + i], b = blocker[k*(bins+1) + i];
+            sa += a;  saa += a*a;
+            sb += b;  sbb += b*b;
+            sd += b-a;  sdd += (b-a)*(b-a);
+        }
+        // variances of the means
+        double va = (n > 1) ? fmax(saa - sa*sa/n, 0)/(n-1)/n : 0;
+        double vb = (n > 1) ? fmax(sbb - sb*sb/n, 0)/(n-1)/n : 0;
+        double vd = (n > 1) ? fmax(sdd - sd*sd/n, 0)/(n-1)/n : 0;
+        
+        diff[i] = sd/n;
+        se[i]   = sqrt(vd);
+        
+        printf("   spike %2d:  %+0.4f +- %0.4f   independent +- %0.4f\n", i, diff[i], se[i], sqrt(va + vb));
+        
+        if (vd > 0) {
+            ratio += (va + vb)/vd/bins;
+        }
+    }
+    printf(" pairing does with %d trials what independent trials need ~%0.1fx as many for\n", n, ratio);
+    
+    if (save_data) 
+    {
+        output_writer().submit( [=]() mutable 
+        {
+            char fn[100];
+            int nnn=((int)1000/ex.isi);
+            
+            sprintf(fn, "%s/prDIFF%dHz.csv", ex.out, nnn);
+            save_bins(diff.data(), bins, fn);
+            sprintf(fn, "%s/prDIFF%dHz_se.csv", ex.out, nnn);
+            save_bins(se.data(), bins, fn);
+        });
+    }
+}
+
+
+// The variables of the Ensemble of sim():  ex.ensemble and b_ca_PreNMDAR, 
+// whose mean over the trials is always saved.
+//
+std::string ensemble_spec(EX & ex)
+{
+    std::string spec = ex.ensemble ? ex.ensemble : "";
+    
+    for(size_t beg=0; beg < spec.size(); )
+    {
+        size_t end = spec.find(',', beg);
+        if (end == std::string::npos) {
+            end = spec.size();
+        }
+        std::string item = spec.substr(beg, end-beg);
+        
+        if (item.substr(0, item.find_first_of(":@")) == "b_ca_PreNMDAR") {
+            return spec;   // already there
+        }
+        beg = end+1;
+    }
+    return spec.empty() ? "b_ca_PreNMDAR" : spec + ",b_ca_PreNMDAR";
+}
+
+// 1 if ex.ensemble lists b_ca_PreNMDAR only, or nothing:  the one variable
+// the batched kernel records, see trials().
+//
+int ensemble_batched(EX & ex)
+{
+    std::string spec = ensemble_spec(ex);
+    
+    for(size_t beg=0; beg < spec.size(); )
+    {
+        size_t end = spec.find(',', beg);
+        if (end == std::string::npos) {
+            end = spec.size();
+        }
+        std::string item = spec.substr(beg, end-beg);
+        
+        if (item.substr(0, item.find_first_of(":@")) != "b_ca_PreNMDAR") {
+            return 0;
+        }
+        beg = end+1;
+    }
+    return 1;
+}
+
+
 //! Simulation
 /*!
 The sim function simulates an experiment where the Schaffer collateral axons are 
@@ -46,8 +463,20 @@ There are three cases: the hippocampal slice is perfused by
 (2) ACSF and AP5 (NMDA receptor antagonist),
 (3) ACSF and Ry  (ryanodine receptor antagonist).
 
-For each case, the experiment is repeated 100 or more times (Trials).
+For each case, the experiment is repeated 100 or more times (Trials).  The 
+trials run in parallel on ex.threads worker threads, and the files are written
+by the writer thread (see Writer) while the next case runs.
+
+If ex.history < ex.tn the traces are rings and memory does not grow with the 
+length of the spike train.  The traces saved are those of the probes in 
+ex.probes (see Recorder), recorded during the last trial of each case.
+
+With ex.hoist the membrane, which is the same in every trial, is integrated 
+once before the first (see Drive).  With ex.exact a condition whose release
+probabilities are the same in every trial runs one trial, and with 
+ex.meanfield every condition does, see exact.h.
 */
+template <class Vesicle>
 void sim(double * pr_ACSF_barChart, double * pr_BLOCKER_barChart, EX ex, int save_data) 
 {    
  
@@ -57,25 +486,40 @@ void sim(double * pr_ACSF_barChart, double * pr_BLOCKER_barChart, EX ex, int sav
     pr_ACSF_barChart_raw     = init_double(ex.bins); 
     pr_BLOCKER_barChart_raw  = init_double(ex.bins); 
     
-    int arrayLength = sizeof(pr_ACSF_barChart)/sizeof(double);  // s/b 11 if 10 spikes
-    
-    for(int i = 0; i < arrayLength; ++i) 
+    for(int i = 0; i <= ex.bins; ++i)   // 11 if 10 spikes
     {
       pr_ACSF_barChart[i]=0;
       pr_BLOCKER_barChart[i]=0;
     }
     
-    double totalRate=0;
-    double rate=0;
-    double SE=0;
+    // one synapse per worker thread, allocated by the worker that uses it
+    int workers = shared_pool(ex.threads).size();
     
-    Bouton B;
-    Spine  S;
-    Astro  A;
+    Synapse<Vesicle> ** syn = new Synapse<Vesicle> * [workers];
+    for(int w=0; w < workers; ++w) {
+        syn[w]=0;
+    }
+    
+    if (ex.meanfield && Vesicle::EXACT) {   // one trial:  nothing to pair, no errors
+        ex.paired = 0;
+        ex.precision = 0;
+    }
+    
+    // the same in every trial:  integrated once, before the synapses share it
+    ex.drive = ex.hoist ? new Drive(ex) : 0;
+    
+    Recorder rec(ex.probes, ex);   // records the last trial of each condition
     
-    B = Bouton(ex.tn, ex.vca);   
-    S = Spine(ex.tn);
-    A = Astro(ex.tn);
+    Ensemble * ens = save_data ? new Ensemble(ensemble_spec(ex).c_str(), ex.quantiles, ex) : 0;   // statistics of all of them
+    
+    // ex.paired, ex.precision:  the release events of every trial, to pair 
+    // them up or to know the errors of the bars
+    double * trialCharts[2] = { 0, 0 };
+    int used[2];   // trials run in each condition
+    
+    for(int c=0; c < 2 && (ex.paired || ex.precision > 0) && ex.replay == 0; ++c) {
+        trialCharts[c] = new double[(int) ex.trials*((int) ex.bins+1)]();
+    }
     
     int AP5=0;
     int RY=0;  
@@ -84,12 +528,9 @@ void sim(double * pr_ACSF_barChart, double * pr_BLOCKER_barChart, EX ex, int sav
   // to generate a different sequence of "pseudo random" numbers.   
   // Consequently, different seed integers can have a large impact on output 
   // even where the output is the mean based on more than 100 trials.  
+  // See trial():  each trial has its own streams keyed by ex.seed.
   for(int BLOCKER=0; BLOCKER < 2; ++BLOCKER)  // 0 == no BLOCKER 
   {   
-      srand(6); // 13 --> .32   .35 
-      //srand(time(NULL)); //to generate a different seq of rand values every time. 
-      totalRate = 0;
-      
       if (ex.AP5_exp)   // experiment using ACSF or AP5 blocker
       {
          AP5 = BLOCKER;
@@ -102,64 +543,61 @@ void sim(double * pr_ACSF_barChart, double * pr_BLOCKER_barChart, EX ex, int sav
          printf("RY=%d\n", RY);
       }  
       
-        for(int TrialNumber=1; TrialNumber <= ex.trials; ++TrialNumber )
-        {
-        B.set(ex.tn);   
-        B.ves.set(ex.tn); 
-        B.er.set(ex.tn); 
-        S.set(ex.tn); 
-        A.set(ex.tn); 
-          
-        for(int i=1; i <= ex.tn; ++i) 
-        {  
-            double aG=0;
-         
-            if (ex.astro == 1) {
-                aG=A.aG_syn[i]; 
-            }          
-            B.bouton_model(i, ex, aG, AP5, RY);
-            S.spine_model_1( i, ex.t[i], ex.deltaT, B.ves.lastRelease, B.ves.G_syn[i]);
-            A.astro_model(   i, ex.t[i], ex.deltaT, B.ves.lastRelease, B.ves.G_syn[i]);
-        }
-       
-         rate = (double) B.ves.vesiclesReleased/ex.spikeCount;
-         totalRate+=rate;
-         
-         int binNumber=0;
-         for(int i=1; i <= ex.tn; ++i) 
-         {
-           binNumber += ex.spikes[i];
-        
-           if (binNumber >= 1 && binNumber <= 10) 
-           {
-              if (BLOCKER ==0) {
-                  pr_ACSF_barChart[binNumber] += (double) B.ves.VR_event[i];
-              }
-              else {
-                  pr_BLOCKER_barChart[binNumber] += (double) B.ves.VR_event[i];
-              }
-           }
-         }                                                
-        } // end of trials for loop
+      double * barChart = (BLOCKER == 0) ? pr_ACSF_barChart : pr_BLOCKER_barChart;
       
+      // ex.precision:  rounds of trials until the confidence intervals of all 
+      // the bars are narrow enough, or ex.trials have run.  The size of each 
+      // round depends on the results so far only, not on the threads.
+      // ex.exact, ex.meanfield:  the releases of one trial are probabilities, see exact.h
+      int exact = Vesicle::EXACT && exact_condition(ex, AP5);
       
+      int n=0, target = (ex.precision > 0 && ! exact) ? ex.min_trials : (int) ex.trials;
       
-      // calculate means
-      
-      for(int i =1; i < ex.tn; ++i) 
+      for(;;)
       {
-          B.ca_PreNMDAR_mean[i] = (double) B.ca_PreNMDAR_mean[i]/ex.trials;      
+         int to = (ex.precision > 0) ? LANES*((target + LANES-1)/LANES) : target;
+         
+         if (to > ex.trials || ex.replay > 0) {
+            to = (int) ex.trials;
+         }
+         rec.clear(BLOCKER);   // records the last trial of the last round
+         
+         trials(syn, ex, AP5, RY, BLOCKER, barChart, save_data ? &rec : 0, trialCharts[BLOCKER], ens, exact ? to : n+1, to);
+         n = exact ? 1 : to;
+         
+         if (exact || ex.precision <= 0 || trialCharts[BLOCKER] == 0 || n >= ex.trials) {
+            break;
+         }
+         double width = confidence(trialCharts[BLOCKER], n, ex);
+         
+         if (width <= ex.precision) {
+            break;
+         }
+         // the error goes as 1/sqrt(trials)
+         target = (int) ceil(1.1*n*(width/ex.precision)*(width/ex.precision));
+         
+         if (target < n + LANES) {
+            target = n + LANES;
+         }
+      }
+      used[BLOCKER] = n;
+      
+      if (exact) {
+         printf(" %s:  %s release probabilities, from one trial\n", BLOCKER ? "blocker" : "ACSF", ex.meanfield ? "mean field" : "exact");
+      }
+      else if (ex.precision > 0 && trialCharts[BLOCKER] != 0) {
+         printf(" %s:  %d trials, bars within +- %0.4f (95%%)\n", BLOCKER ? "blocker" : "ACSF", n, confidence(trialCharts[BLOCKER], n, ex));
       }
       
       for(int i=1; i <= ex.bins; ++i) 
       {
          if (BLOCKER == 0) {
-             pr_ACSF_barChart[i]        = (double) pr_ACSF_barChart[i]/ex.trials;
+             pr_ACSF_barChart[i]        = (double) pr_ACSF_barChart[i]/used[BLOCKER];
              pr_ACSF_barChart_raw[i]    = pr_ACSF_barChart[i];          // make a copy of the mean Pr for ACSF
          }
          
          if (BLOCKER == 1) {
-             pr_BLOCKER_barChart[i]     = (double) pr_BLOCKER_barChart[i]/ex.trials; 
+             pr_BLOCKER_barChart[i]     = (double) pr_BLOCKER_barChart[i]/used[BLOCKER]; 
              pr_BLOCKER_barChart_raw[i] = pr_BLOCKER_barChart[i];    // make a copy of the mean Pr for condition of Blocked receptor  
          }   
       }
@@ -193,8 +631,8 @@ void sim(double * pr_ACSF_barChart, double * pr_BLOCKER_barChart, EX ex, int sav
         pr_ACSF_barChart_raw[1]=ex.avg;
         pr_BLOCKER_barChart_raw[1] = ex.avg;
         
-        B.ves.P_release[1]=ex.avg;
-        B.ves.P_release_BLOCKER[1]=ex.avg;
+        rec.set("b_ves_P_release", 1, ex.avg);
+        rec.set("b_ves_P_release_BLOCKER", 1, ex.avg);
         printf("Spike 1 mean set at %0.2f for isi=%0.0f ms.\n", ex.avg, ex.isi);
     }
     else
@@ -204,8 +642,8 @@ void sim(double * pr_ACSF_barChart, double * pr_BLOCKER_barChart, EX ex, int sav
         pr_ACSF_barChart_raw[1]=ex.avg;
         pr_BLOCKER_barChart_raw[1] = ex.avg;
         
-        B.ves.P_release[1]=ex.avg;
-        B.ves.P_release_BLOCKER[1]=ex.avg;
+        rec.set("b_ves_P_release", 1, ex.avg);
+        rec.set("b_ves_P_release_BLOCKER", 1, ex.avg);
         printf("Spike 1 mean set at %0.2f for isi=%0.0f ms.\n", ex.avg, ex.isi);
     }
     
@@ -243,14 +681,351 @@ void sim(double * pr_ACSF_barChart, double * pr_BLOCKER_barChart, EX ex, int sav
      if (save_data)
      {
         printf("\n saving data \n");
-        if ( ! BLOCKER)  
-        {   
-           save_acsf(A, S, B, pr_ACSF_barChart, pr_ACSF_barChart_raw, ex);     
-        }
-        else  
-        {            
-           save_blocker(   B,  pr_BLOCKER_barChart, pr_BLOCKER_barChart_raw, ex);
+        TraceSet * traces = new TraceSet(ex, BLOCKER);
+        
+        rec.collect(BLOCKER, *traces, ex);
+        
+        if (ens != 0) {
+           ens->collect(BLOCKER, *traces, ex);
         }
+        
+        double * chart     = BLOCKER ? pr_BLOCKER_barChart     : pr_ACSF_barChart;
+        double * chart_raw = BLOCKER ? pr_BLOCKER_barChart_raw : pr_ACSF_barChart_raw;
+        
+        save_output(ex, BLOCKER, traces, chart, chart_raw, ex.cache && ! ex.paired);
      }
    }   // end of experiment in { ACSF, BLOCKER }
+   
+   if (trialCharts[0] != 0) 
+   {
+      if (ex.paired) {
+         paired_difference(trialCharts[0], trialCharts[1], (used[0] < used[1]) ? used[0] : used[1], ex, save_data);
+      }
+      if (ex.precision > 0 && save_data) 
+      {
+         std::vector<double> count(3, 0);
+         count[1] = used[0];
+         count[2] = used[1];
+         
+         output_writer().submit( [=]() mutable 
+         {
+            char fn[100];
+            sprintf(fn, "%s/trials%dHz.csv", ex.out, (int) (1000/ex.isi));
+            save_bins(count.data(), 2, fn);
+         });
+      }
+      delete[] trialCharts[0];
+      delete[] trialCharts[1];
+   }
+   
+   if (ex.cache && ! ex.paired) 
+   {
+      // queued after the traces, see cache.h
+      std::vector<double> a(pr_ACSF_barChart, pr_ACSF_barChart + (int) ex.bins + 1);
+      std::vector<double> a_raw(pr_ACSF_barChart_raw, pr_ACSF_barChart_raw + (int) ex.bins + 1);
+      std::vector<double> b(pr_BLOCKER_barChart, pr_BLOCKER_barChart + (int) ex.bins + 1);
+      std::vector<double> b_raw(pr_BLOCKER_barChart_raw, pr_BLOCKER_barChart_raw + (int) ex.bins + 1);
+      
+      output_writer().submit( [=]() mutable {
+         cache_store(ex, a.data(), a_raw.data(), b.data(), b_raw.data());
+      });
+   }
+   
+   for(int w=0; w < workers; ++w) {
+       delete syn[w];
+   }
+   delete ens;
+   delete[] syn;
+   delete ex.drive;
+   delete[] pr_ACSF_barChart_raw;
+   delete[] pr_BLOCKER_barChart_raw;
  }
+
+
+//! Simulation read from the result cache
+/*!
+Reads the bar charts of experiment ex from the cache ex.cache, and if 
+save_data its traces, and saves them as sim() would have.  Returns 0 if the 
+cache does not have them.
+*/
+int sim_cached(double * pr_ACSF_barChart, double * pr_BLOCKER_barChart, EX & ex, int save_data)
+{
+    std::vector<double> acsf_raw(ex.bins + 1), blocker_raw(ex.bins + 1);
+    double error;
+    
+    if ( ! cache_load(ex, pr_ACSF_barChart, acsf_raw.data(), pr_BLOCKER_barChart, blocker_raw.data(), error) ) {
+        return 0;
+    }
+    
+    if (save_data)
+    {
+        TraceSet * traces[2] = { new TraceSet(ex, 0), new TraceSet(ex, 1) };
+        
+        if ( ! cache_load_traces(ex, 0, *traces[0]) || ! cache_load_traces(ex, 1, *traces[1]) ) {
+            delete traces[0];
+            delete traces[1];
+            return 0;
+        }
+        save_output(ex, 0, traces[0], pr_ACSF_barChart, acsf_raw.data(), 0);
+        save_output(ex, 1, traces[1], pr_BLOCKER_barChart, blocker_raw.data(), 0);
+    }
+    
+    printf("%s calcium sensor, isi=%0.0f: from the cache, MSE=%0.3f\n", sensor_names[ex.sensor], ex.isi, error);
+    
+    return 1;
+}
+
+
+//! Simulation with the calcium sensor model chosen at run time
+/*!
+Picks the vesicle class for ex.sensor once, so every step of every trial runs
+in code compiled for that sensor model, with release() inlined.  Prints the
+run time, to compare the models.  With ex.cache an experiment already in the
+cache is read from it instead, see sim_cached();  not with ex.paired, as 
+the cache does not keep the paired differences.
+*/
+void sim(double * pr_ACSF_barChart, double * pr_BLOCKER_barChart, EX ex, int save_data) 
+{
+    auto start = std::chrono::steady_clock::now();
+    
+    if (ex.cache && ! ex.paired && sim_cached(pr_ACSF_barChart, pr_BLOCKER_barChart, ex, save_data)) {
+        return;
+    }
+    
+    switch (ex.sensor)
+    {
+        case SENSOR_MARKOV:      
+            sim<Vesicle_Markov>(pr_ACSF_barChart, pr_BLOCKER_barChart, ex, save_data);     
+            break;
+        case SENSOR_MARKOV6:     
+            sim<Vesicle_Markov_6>(pr_ACSF_barChart, pr_BLOCKER_barChart, ex, save_data);   
+            break;
+        case SENSOR_ALLOSTERIC:  
+            sim<Vesicle_Allosteric>(pr_ACSF_barChart, pr_BLOCKER_barChart, ex, save_data); 
+            break;
+        default:                 
+            sim<Vesicle_Hill>(pr_ACSF_barChart, pr_BLOCKER_barChart, ex, save_data);       
+            break;
+    }
+    
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    
+    printf("%s calcium sensor, isi=%0.0f: %0.2f s\n", sensor_names[ex.sensor], ex.isi, elapsed.count());
+}
+
+
+//! Equivalence of the release samplers
+/*!
+hazard=check:  before the experiments, tests that one Exp(1) threshold per
+release (HazardRelease) releases as one draw per time step does, twice:
+
+(1) the timing:  SAMPLES windows of a rate that rises and falls, the release
+    step of each drawn both ways, and the chi-square test of homogeneity of
+    the two histograms (no release is a bin too, rare steps are pooled);
+(2) the model:  ex.trials trials of both conditions of ex run both ways, on
+    the seeds ex.seed and ex.seed+1, and the two proportion z test of every
+    bar;  its p value is Bonferroni's, as the spikes of a trial are not
+    independent.
+
+Prints both p values and returns the smaller;  below 0.001 is a failure.
+*/
+static constexpr int SAMPLES=200000;
+
+template <class Vesicle>
+double hazard_check(EX ex)
+{
+    // (1) timing, with the numbers of no trial
+    const int W = (int) (5/ex.deltaT);   // a Vesicle_Hill window
+    
+    std::vector<double> p(W), count[2] = { std::vector<double>(W+1, 0), std::vector<double>(W+1, 0) };
+    
+    for(int j=0; j < W; ++j) {
+        p[j] = 0.05*exp( -ipow<2>((j - 0.3*W)/(0.15*W)) );
+    }
+    
+    EX e = ex;
+    e.paired = 0;
+    
+    for(int m=0; m < 2; ++m)
+    {
+        Random rng(ex.seed, m, 0, RNG_OTHER);
+        HazardRelease sampler;
+        
+        for(int s=0; s < SAMPLES; ++s)
+        {
+            int j=0;
+            sampler.reset();
+            
+            while (j < W && ! (m ? sampler.step(j, p[j], rng, e) : rng.uniform() < p[j])) {
+                ++j;
+            }
+            count[m][j] += 1;   // j == W:  no release
+        }
+    }
+    
+    double chi2=0, a=0, b=0;
+    int df=-1;
+    
+    for(int j=0; j <= W; ++j)
+    {
+        a += count[0][j];
+        b += count[1][j];
+        
+        if (a + b >= 20 || j == W) {   // pool the rare steps with the next
+            chi2 += (a - b)*(a - b)/(a + b);
+            a=b=0;
+            ++df;
+        }
+    }
+    // Wilson-Hilferty
+    double z = (cbrt(chi2/df) - (1 - 2.0/(9*df)))/sqrt(2.0/(9*df));
+    double p_timing = 0.5*erfc(z/sqrt(2.0));
+    
+    printf(" hazard check, timing:  chi-square %0.1f, %d df, p=%0.3f\n", chi2, df, p_timing);
+    
+    // (2) the model
+    int bins = (int) ex.bins, n = (int) ex.trials;
+    int workers = shared_pool(ex.threads).size();
+    
+    std::vector<double> bars[2][2];
+    
+    for(int m=0; m < 2; ++m)
+    {
+        e = ex;
+        e.hazard = m;
+        e.seed   = ex.seed + m;
+        e.paired = e.rb = e.exact = e.precision = 0;
+        e.replay = 0;
+        e.drive  = e.hoist ? new Drive(e) : 0;
+        
+        Synapse<Vesicle> ** syn = new Synapse<Vesicle> * [workers]();
+        
+        for(int BLOCKER=0; BLOCKER < 2; ++BLOCKER)
+        {
+            int AP5 = e.AP5_exp ? BLOCKER : 0;
+            int RY  = e.RY_exp  ? BLOCKER : 0;
+            
+            bars[m][BLOCKER].assign(bins+1, 0);
+            trials(syn, e, AP5, RY, BLOCKER, bars[m][BLOCKER].data(), 0, 0, 0, 1, n);
+        }
+        
+        for(int w=0; w < workers; ++w) {
+            delete syn[w];
+        }
+        delete[] syn;
+        delete e.drive;
+    }
+    
+    double z_max=0;
+    
+    for(int BLOCKER=0; BLOCKER < 2; ++BLOCKER) {
+        for(int i=1; i <= bins; ++i)
+        {
+            double r0 = bars[0][BLOCKER][i], r1 = bars[1][BLOCKER][i];
+            double q = (r0 + r1)/(2*n);   // pooled
+            
+            if (q > 0 && q < 1) {
+                z_max = fmax(z_max, fabs(r0 - r1)/n/sqrt(q*(1 - q)*2/n));
+            }
+        }
+    }
+    double p_model = fmin(1, 2*bins*erfc(z_max/sqrt(2.0)));
+    
+    printf(" hazard check, %s isi=%0.0f:  %d trials, largest |z| of the bars %0.2f, p=%0.3f\n", 
+           sensor_names[ex.sensor], ex.isi, n, z_max, p_model);
+    
+    return fmin(p_timing, p_model);
+}
+
+// hazard_check() for the sensor of ex;  1 for a sensor that does not sample
+// its releases from a rate.
+double hazard_check(EX & ex)
+{
+    switch (ex.sensor)
+    {
+        case SENSOR_ALLOSTERIC:  return hazard_check<Vesicle_Allosteric>(ex);
+        case SENSOR_HILL:        return hazard_check<Vesicle_Hill>(ex);
+        default:                 return 1;
+    }
+}
+
+
+//! Deviation of the mean field
+/*!
+meanfield=check:  before the experiments, runs each experiment of ex that 
+mse() scores (the isis 1000, 200 and 50), or every one if none is, both 
+with ex.trials trials and as a mean field, and prints the bars of both 
+conditions both ways and their difference, per spike, and the largest and 
+RMS differences, the MSEs against the data and the run times of both.  The 
+mean field has no random numbers:  its difference is its bias, plus the 
+sampling error of the trials.  Only the Hill and Allosteric sensors have 
+one.
+
+Returns the largest difference, in percent of the first bar.
+*/
+double meanfield_check(std::vector<EX> & ex)
+{
+    int any=0;
+    
+    for(size_t k=0; k < ex.size(); ++k) {
+        any |= scored(ex[k]);
+    }
+    double worst=0;
+    
+    for(size_t k=0; k < ex.size(); ++k)
+    {
+        if ((any && ! scored(ex[k])) || (ex[k].sensor != SENSOR_HILL && ex[k].sensor != SENSOR_ALLOSTERIC)) {
+            continue;   // the Markov sensors have no mean field
+        }
+        double * bars[2][2];   // [mean field][BLOCKER]
+        double seconds[2];
+        
+        for(int m=0; m < 2; ++m)
+        {
+            EX e = ex[k];
+            e.meanfield = m;
+            
+            bars[m][0] = init_double(e.bins);
+            bars[m][1] = init_double(e.bins);
+            
+            auto start = std::chrono::steady_clock::now();
+            sim(bars[m][0], bars[m][1], e, 0);
+            
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            seconds[m] = elapsed.count();
+        }
+        
+        printf("\n mean field against %0.0f trials, isi=%0.0f (%% of the first bar)\n", ex[k].trials, ex[k].isi);
+        printf(" spike      ACSF trials    mean field  difference    blocker trials    mean field  difference\n");
+        
+        double max_diff=0, ss=0;
+        int n=0;
+        
+        for(int i=1; i <= ex[k].bins; ++i)
+        {
+            printf(" %5d", i);
+            
+            for(int BLOCKER=0; BLOCKER < 2; ++BLOCKER)
+            {
+                double d = bars[1][BLOCKER][i] - bars[0][BLOCKER][i];
+                
+                printf("  %14.2f  %12.2f  %10.2f", bars[0][BLOCKER][i], bars[1][BLOCKER][i], d);
+                
+                max_diff = (fabs(d) > max_diff) ? fabs(d) : max_diff;
+                ss += d*d;
+                ++n;
+            }
+            printf("\n");
+        }
+        printf(" largest difference %0.2f, RMS %0.2f;  MSE %0.3f with trials, %0.3f mean field;  %0.2f s and %0.3f s\n", 
+               max_diff, sqrt(ss/n), mse(bars[0][0], bars[0][1], ex[k]), mse(bars[1][0], bars[1][1], ex[k]), seconds[0], seconds[1]);
+        
+        worst = (max_diff > worst) ? max_diff : worst;
+        
+        for(int m=0; m < 2; ++m) {
+            delete[] bars[m][0];
+            delete[] bars[m][1];
+        }
+    }
+    return worst;
+}
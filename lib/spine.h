@@ -28,9 +28,9 @@ static constexpr double Vrest=-70;  // Resting membrane potential of spine membr
 
                                      
 // Post-synaptic spine variables
-double * Vm;    // Membrane potential
-double * Iampa;  // Current through AMPAR
-double * Inmda;
+Trace Vm;    // Membrane potential
+Trace Iampa;  // Current through AMPAR
+Trace Inmda;
 //double * Ip2x;
 
 AMPA_spine ampaR;
@@ -51,9 +51,9 @@ NMDA_spine nmdaR;
          vspine=1e-3*(4.0/3.0)*PI*pow(rad_spine,3);  
          sspine=4*PI*pow(rad_spine,2);      
          
-         Vm    =init_double(tn+2);  // Membrane potential
-         Iampa =init_double(tn+2);  // Current through AMPAR         
-         Inmda =init_double(tn+2);
+         Vm    =Trace(tn);  // Membrane potential
+         Iampa =Trace(tn);  // Current through AMPAR         
+         Inmda =Trace(tn);
          //Ip2x  =init_double(tn+2);  
          
          ampaR=AMPA_spine();
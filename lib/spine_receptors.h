@@ -78,6 +78,11 @@ AMPA Rs produce larger EPSCs than other types of ionotropic glu receptors.
 #include "utilities.h"
 #endif
 
+#ifndef _vtable_h_included_
+#define _vtable_h_included_
+#include "vtable.h"
+#endif
+
 class AMPA_spine
 {
  public:
@@ -167,10 +172,12 @@ class NMDA_spine
     static constexpr double Mg=1.0;        // conc of extracellular Mg in mM
     
     double s;
+    int tables;    // 1: Mg++ unblock from voltage_table()
     
     NMDA_spine( ) 
     {
        s=0;
+       tables=0;
     }
     
     // VT half activatio:  VT= 16.13 ln([Mg]/3.57)
@@ -180,7 +187,8 @@ class NMDA_spine
 
     double syn(double deltaT, double glu, double Vm)
     {   
-        double B =  1/( 1 + exp(-0.062 * Vm) * Mg/3.57 );  // p163 Ermentrout, 2010
+        double unblock = tables ? voltage_table()(VT_MG, Vm) : exp(-0.062 * Vm);
+        double B =  1/( 1 + unblock * Mg/3.57 );  // p163 Ermentrout, 2010
  
         s = s + deltaT * (a_r * glu * (1 - s) - a_d * s);
         
@@ -271,7 +279,7 @@ class GABA_B_spine
         //Tglu = Tmax/(1 + exp(-(V_pre - V_T)/Kp) )
          
         //   the current I_GABA is a nonlinear saturating function of s 
-        double I_GABA = g_GABA * ( pow(s,n)/( pow(s,n) + Kd )) * (Vm - E_K);
+        double I_GABA = g_GABA * ( ipow(s,n)/( ipow(s,n) + Kd )) * (Vm - E_K);
         
         r = r + a_r * glu * (1 - r) - a_d * r;
  
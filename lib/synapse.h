@@ -0,0 +1,44 @@
+#ifndef _utilities_h_included_
+#define _utilities_h_included_
+#include "utilities.h"
+#endif
+
+#ifndef _bouton_h_included_
+#define _bouton_h_included_
+#include "bouton.h"
+#endif
+
+#ifndef _spine_h_included_
+#define _spine_h_included_
+#include "spine.h"
+#endif
+
+#ifndef _astrocyte_h_included_
+#define _astrocyte_h_included_
+#include "astrocyte.h"
+#endif
+
+//! Synapse
+/*!
+One tripartite synapse: the presynaptic bouton, the postsynaptic spine and the
+astrocyte.  Every worker thread owns one, so trials running at the same time
+never share state.  Its traces keep ex.history time points:  all of them, or
+just the last few if they are rings (see Trace).  Vesicle is the calcium 
+sensor model of the bouton.  With ex.drive its membrane traces are those
+of the Drive, shared by all the synapses.
+*/
+template <class Vesicle>
+struct Synapse
+{
+    Bouton<Vesicle> B;
+    Spine  S;
+    Astro  A;
+
+    Synapse(EX & ex)
+    {
+        B = Bouton<Vesicle>(ex.history, ex.vca, ex.drive);
+        S = Spine(ex.history);
+        S.nmdaR.tables = ex.tables;
+        A = Astro(ex.history);
+    }
+};
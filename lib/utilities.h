@@ -4,6 +4,55 @@
 #include <math.h>
 #endif
 
+#ifndef _random_h_included_
+#define _random_h_included_
+#include "random.h"
+#endif
+
+#ifndef _hill_h_included_
+#define _hill_h_included_
+#include "hill.h"
+#endif
+
+#ifndef _memory_h_included_
+#define _memory_h_included_
+#include <memory>
+#endif
+
+// Calcium sensor models (vesicle classes), see Bouton.  The model named at 
+// compile time, -DHill, -DMarkov, -DMarkov6 or -DAllosteric, is the default.
+//
+enum { SENSOR_HILL, SENSOR_MARKOV, SENSOR_MARKOV6, SENSOR_ALLOSTERIC, SENSORS };
+
+static const char * sensor_names[SENSORS] = { "Hill", "Markov", "Markov6", "Allosteric" };
+
+#if defined(Markov)
+static constexpr int SENSOR_DEFAULT = SENSOR_MARKOV;
+#elif defined(Markov6)
+static constexpr int SENSOR_DEFAULT = SENSOR_MARKOV6;
+#elif defined(Allosteric)
+static constexpr int SENSOR_DEFAULT = SENSOR_ALLOSTERIC;
+#else
+static constexpr int SENSOR_DEFAULT = SENSOR_HILL;
+#endif
+
+// Time integration of the bouton and the cleft, see relax().  
+// INTEGRATOR_EULER is forward Euler, as the model was written and tuned at 
+// deltaT=REFERENCE_DT.  INTEGRATOR_RL integrates the gates with Rush-Larsen 
+// and v and the calcium pools with exponential Euler, so it is stable at 
+// larger time steps.
+//
+enum { INTEGRATOR_EULER, INTEGRATOR_RL, INTEGRATORS };
+
+static const char * integrator_names[INTEGRATORS] = { "euler", "rl" };
+
+static constexpr double REFERENCE_DT=0.05;   // ms
+
+static constexpr int HAZARD_CHECK=2;   // ex.hazard:  test it first, see hazard_check()
+static constexpr int MEANFIELD_CHECK=2;   // ex.meanfield:  compare with the trials first, see meanfield_check()
+
+class Drive;
+
 struct EX {
                // For Hill equation based calcium sensor.
   double n1;   // Hill coefficient for sensor 1:  activator 
@@ -51,6 +100,33 @@ struct EX {
   double ACSF_50_isi_base_Pr;
   
   double base_Pr;
+  
+  int threads;    // worker threads for the trials, 0 means one per core
+  int seed;       // base seed of the random number streams
+  int replay;     // if > 0, run only this trial number (see Random)
+  int history;    // time points kept by each Trace:  tn, or fewer for rings
+  const char * probes;  // variables to record, 0 for the default (see Recorder)
+  int csv;        // 1: save traces as csv files, 0: as csv/trace*.bin (see TraceSet)
+  int sweep;      // 1: one of several experiments (isis) run at the same time
+  int sensor;     // calcium sensor model, SENSOR_HILL ...
+  const char * out;   // directory for the output files, "csv" 
+  int batch;      // 1: run blocks of trials side by side in SIMD lanes (see batch.h)
+  int ff;         // 1: batched trials fast-forward through quiescent stretches
+  int integrator; // INTEGRATOR_EULER or INTEGRATOR_RL
+  int tables;     // 1: voltage dependent rates from voltage_table() (see vtable.h)
+  int ssa;        // 1: Markov sensors jump at exact random times, not once per step
+  const char * cache;  // directory of the result cache, 0 for none (see cache.h)
+  int paired;     // 1: both conditions draw the same random numbers (see paired_difference())
+  double precision;  // > 0: trials until the 95% intervals of the bars are this narrow (see sim())
+  int min_trials;    // ... and at least this many;  trials is the most
+  const char * ensemble;   // variables averaged over all the trials, 0 for none (see Ensemble)
+  const char * quantiles;  // their percentiles, e.g. "5,50,95", or 0
+  int hoist;      // 1: the trial-invariant membrane is integrated once per experiment (see Drive)
+  Drive * drive;  // ... by sim(), 0 otherwise
+  int exact;      // 1: the bars of a condition without random feedback from one trial (see exact.h)
+  int rb;         // 1: the bars add up the expected releases of the spikes (see WindowRelease)
+  int hazard;     // 1: one random number per release, not per step (see HazardRelease);  HAZARD_CHECK
+  int meanfield;  // 1: one trial releasing the expected vesicles (see exact_condition());  MEANFIELD_CHECK
 };
 
 
@@ -60,14 +136,152 @@ EX buildPoissonTrain(double isi, double seconds, double trials, double deltaT, i
 double * init_double(int Len);
 int    * init_int(int Len);
 
+
+//! Trace
+/*!
+The per time point values of one model variable, indexed by time point i 
+like the arrays made by init_double(Len):  Len+2 elements, all zero.
+
+If Len+2 is a power of 2 the trace is a ring:  x[i] is stored at i mod (Len+2),
+so only the last Len+2 time points are kept and memory does not grow with the
+number of time points.  The dynamics only read x[i], x[i+1] and, in 
+bouton_model, x[i - delay_time_steps], so a ring longer than the longest delay
+gives the same results as a full length trace.  See ring_history().
+
+Note: for a full length trace, i & mask == i for every i < Len+2 whether or
+not Len+2 happens to be a power of 2.
+
+Copies share the elements (a Drive and the boutons reading it, see share()),
+and the last copy to go frees them.
+*/
+template <typename T>
+class TraceT
+{
+public:
+
+T * data;
+int mask;     // Len+1 for a ring, all bits set otherwise
+int length;   // Len+2 elements
+
+TraceT() { data=0; mask=~0; length=0; }
+
+TraceT(int Len)
+{
+    length = Len+2;
+    data = new T[length];
+    owner = std::shared_ptr<T>(data, std::default_delete<T[]>());
+    
+    for(int i=0; i < length; ++i) {
+        data[i]=0;
+    }
+    
+    mask = ( (length & (length-1)) == 0 ) ? length-1 : ~0;
+}
+
+inline T & operator[](int i) { return data[i & mask]; }
+
+int ring() { return mask != ~0; }
+
+private:
+
+std::shared_ptr<T> owner;   // of data
+};
+
+typedef TraceT<double> Trace;
+typedef TraceT<int>    TraceInt;
+
+
+// Time points kept by ring Traces for experiment ex:  enough for the longest
+// look back, (beg_pad+1)/deltaT steps in bouton_model, and such that Len+2 is
+// a power of 2.   Returns ex.tn if that is no shorter than the full trace.
+//
+inline int ring_history(EX & ex)
+{
+    int delay  = (int) ceil( (ex.beg_pad + 1.0)/ex.deltaT ) + 1;
+    int length = 4;
+    
+    while (length < delay + 3) {
+        length *= 2;
+    }
+    
+    return (length - 2 < ex.tn) ? length - 2 : ex.tn;
+}
+
+// One time step of  x' = f - (x - x0)/tau  with f held over the step:  forward 
+// Euler, or exponential Euler, which is exact for the held f and stable for 
+// any time step.
+//
+inline double relax(double x, double f, double x0, double tau, EX & ex)
+{
+    if (ex.integrator == INTEGRATOR_EULER) {
+        return x + ex.deltaT*(f - (x - x0)/tau);
+    }
+    double x_inf = x0 + f*tau;
+    
+    return x_inf + (x - x_inf)*exp(-ex.deltaT/tau);
+}
+
+// Rush-Larsen step of a gate  x' = a (1-x) - b x,  with the rates held.
+//
+inline double rush_larsen(double x, double a, double b, double deltaT)
+{
+    double x_inf = a/(a+b);
+    
+    return x_inf + (x - x_inf)*exp(-(a+b)*deltaT);
+}
+
+// Probability of a release within one time step at rate Pr (per ms).
+//
+inline double step_probability(double Pr, EX & ex)
+{
+    if (ex.integrator == INTEGRATOR_EULER) {
+        return Pr * ex.deltaT;
+    }
+    return -expm1(-Pr * ex.deltaT);
+}
+
 int      Poisson(double mean);
-int      Poisson2(double lambda);
+int      Poisson2(double lambda, Random & rng);
 
 inline double rnd();
+inline void   rnd_seed(int seed);
 
-int markov(double pp[]);
+int markov(double pp[], double u);
 double heaviside(double d);
 
+// Defaults of the fields that choose how an experiment is run, threads ...
+// meanfield, for the spike trains below;  ex.tn must be set.
+//
+void ex_defaults(EX & ex)
+{
+    ex.threads=0;      // one worker thread per core
+    ex.seed=6;         // was srand(6) in sim()
+    ex.replay=0;
+    ex.history=ex.tn;  // full length traces
+    ex.probes=0;
+    ex.csv=0;
+    ex.sweep=0;
+    ex.sensor=SENSOR_DEFAULT;
+    ex.out="csv";
+    ex.batch=1;
+    ex.ff=0;
+    ex.integrator=INTEGRATOR_EULER;
+    ex.tables=0;
+    ex.ssa=0;
+    ex.cache=0;
+    ex.paired=0;
+    ex.precision=0;
+    ex.min_trials=64;
+    ex.ensemble=0;
+    ex.quantiles=0;
+    ex.hoist=1;
+    ex.drive=0;
+    ex.exact=0;
+    ex.rb=0;
+    ex.hazard=0;
+    ex.meanfield=0;
+}
+
 // regular frequency spike train
 //
 void buildTrain(EX &ex) { 
@@ -103,6 +317,8 @@ void buildTrain(EX &ex) {
     ex.rIP3 = 0.5;
     ex.Ca_ex= 3;       // Extracellular [Ca] mM,  2 mM is typical.
     ex.vca  = 130.65;  // 130.65 if [Ca]ex = 3 mM as in McGuinness 2010, used Nernst Eq., 125 if 2 mM   
+    
+    ex_defaults(ex);
 
     double tme=0;
     
@@ -164,6 +380,7 @@ EX buildPoissonTrain(double isi, double seconds, double trials, double deltaT, i
   ex.spikeCount = 0;
   
   ex.rIP3=0.5;
+  ex_defaults(ex);
   ex.Ca_ex=3;     // extracellular [Ca] mM
   ex.vca=130.65;  // 130.65 if [Ca]ex = 3mM, used Nernst Eq., 125 if 2mM   
   
@@ -252,14 +469,14 @@ int Poisson(double mean) //Special technique required: Box-Muller method...
 }
 
 
-int Poisson2(double lambda)
+int Poisson2(double lambda, Random & rng)
 {
   int k=0;
   double L=exp(-lambda), p=1;
   
   do {
     ++k;
-    p *= (double) rand()/(double)(RAND_MAX);
+    p *= rng.uniform();
   } while (p > L);
   
   return --k;
@@ -267,16 +484,27 @@ int Poisson2(double lambda)
 
 
 
+// Random numbers for anything that does not have its own stream.  Each 
+// thread has its own, so threads do not share (or race on) a global state.
+// The simulation components use their own Random streams, see random.h.
+//
+static thread_local Random rnd_stream(6, 0, 0, RNG_OTHER);
+
+inline void rnd_seed(int seed)
+{
+  rnd_stream.seed(seed, 0, 0, RNG_OTHER);
+}
+
 // inline small frequently called functions for speed
 //
 inline double rnd()
 {
-  return (double)rand() / (double)RAND_MAX ;
+  return rnd_stream.uniform();
 }
 
-inline int markov(double pp[])
+// u:  uniform random number (0 to 1)
+inline int markov(double pp[], double u)
 {
-  double u=rnd();    // uniform random number (0 to 1)
   int i=1;           // Initial value of i
   double s=pp[1];    // Probability to stay in the present state
     
@@ -22,6 +22,11 @@
 #include "utilities.h"
 #endif
 
+#ifndef _exact_h_included_
+#define _exact_h_included_
+#include "exact.h"
+#endif
+
 class Vesicle_Allosteric
 {
 public:
@@ -66,11 +71,11 @@ static constexpr double degG=10; // Extracellular glutamate degradation rate; pe
 static constexpr double tau_rec=800;  // Vesicle recovery time constexprant;  ms;   Tsodyks & Markram (1997)
 static constexpr double tau_inact=3;  // Vesicle inactivation time constexprant;  ms;   Tsodyks & Markram (1997)
 
-double * G_syn;  // Synaptic glutamate concentration
-double * R_syn;  // Fraction of releasable vesicles
-double * E_syn;  // Fraction of effective vesicles in synaptic cleft
-double * I_syn;  // Fraction of inactivated vesicles 
-double * RRP;    // Vesicles released 
+Trace G_syn;  // Synaptic glutamate concentration
+Trace R_syn;  // Fraction of releasable vesicles
+Trace E_syn;  // Fraction of effective vesicles in synaptic cleft
+Trace I_syn;  // Fraction of inactivated vesicles 
+Trace RRP;    // Vesicles released 
 
 double lastRelease;         // Time of most recent vesicle release (ms) 
 
@@ -79,13 +84,20 @@ double lastSpike;
 int vesiclesReleased;
 
 
-double * P_release;         // Pr per ms, control condition
-double * P_release_BLOCKER; // Pr per ms, when blocker applied
+Trace P_release;         // Pr per ms, control condition
+Trace P_release_BLOCKER; // Pr per ms, when blocker applied
+
+Trace VR_event;
+Trace AP_event;
+
+Trace Ca_MD;
 
-double * VR_event;
-double * AP_event;
+Random rng;       // random numbers for this vesicle, seeded for each trial
 
-double * Ca_MD;
+static constexpr int EXACT=1;   // no random state:  exact release probabilities, see exact.h
+ExactRelease exact;
+WindowRelease spike_release;   // ex.rb
+HazardRelease sampler;         // ex.hazard
 
 
 Vesicle_Allosteric() { ; }
@@ -95,19 +107,19 @@ Vesicle_Allosteric(int tn)
 {    
     // allocate memory 
     
-    Ca_MD =init_double(tn+2); 
+    Ca_MD =Trace(tn); 
     
-    G_syn=init_double(tn+2); 
-    R_syn=init_double(tn+2);  
-    E_syn=init_double(tn+2);  
-    I_syn=init_double(tn+2);  
-    RRP=init_double(tn+2);  
+    G_syn=Trace(tn); 
+    R_syn=Trace(tn);  
+    E_syn=Trace(tn);  
+    I_syn=Trace(tn);  
+    RRP=Trace(tn);  
     
-    P_release        =init_double(tn+2);
-    P_release_BLOCKER=init_double(tn+2);
+    P_release        =Trace(tn);
+    P_release_BLOCKER=Trace(tn);
 
-    VR_event=init_double(tn+2); 
-    AP_event=init_double(tn+2);  
+    VR_event=Trace(tn); 
+    AP_event=Trace(tn);  
 }
 
 // set values at the start of each trial (N trials per experimental condition
@@ -136,6 +148,10 @@ void set(int tn) {
     
     vesiclesReleased=0;
     
+    exact.reset();
+    spike_release.reset();
+    sampler.reset();
+    
     V0Ca=10;   
     
     V1Ca=2; 
@@ -148,8 +164,94 @@ void set(int tn) {
 }
 
 
+// Rates (per ms) at which a vesicle with k Ca2+ bound binds one more (up) 
+// or loses one (down), at calcium Ca (M).
+//
+static void rates(double Ca, double * up, double * down)
+{
+    for(int k=0; k < 6; ++k)
+    {
+        up[k]   = (5-k)*kon*Ca;
+        down[k] = (k > 0) ? k*koff*ipow(b, k-1) : 0;
+    }
+}
+
+// The vesicle state counts in equilibrium at Ca, same total:  detailed 
+// balance, V[k+1] up[k+1] ... = V[k] up[k].
+//
+void steady_state(double Ca)
+{
+    double up[6], down[6], V[6];
+    rates(Ca, up, down);
+    
+    double total = V0Ca + V1Ca + V2Ca + V3Ca + V4Ca + V5Ca;
+    double sum = V[0] = 1;
+    
+    for(int k=0; k < 5; ++k) {
+        V[k+1] = V[k]*up[k]/down[k+1];
+        sum += V[k+1];
+    }
+    V0Ca = total*V[0]/sum;  V1Ca = total*V[1]/sum;  V2Ca = total*V[2]/sum;
+    V3Ca = total*V[3]/sum;  V4Ca = total*V[4]/sum;  V5Ca = total*V[5]/sum;
+}
+
+// One time step of V' = Q V with Ca held, exactly:  exp(Q deltaT) V by
+// uniformization,  sum over n of  Poisson(n; L deltaT) P^n V,  P = 1 + Q/L, 
+// L the largest rate out of a state.  Every term is non-negative, so the
+// counts never go below zero, whatever deltaT.  The sum stops when the 
+// weights left are below 1e-12, and is scaled by the weights taken, so the
+// total count is kept.
+//
+void propagate(double Ca, double deltaT)
+{
+    double up[6], down[6];
+    rates(Ca, up, down);
+    
+    double L=0;
+    for(int k=0; k < 6; ++k) {
+        L = (up[k] + down[k] > L) ? up[k] + down[k] : L;
+    }
+    
+    if (L*deltaT > 100) {   // exp(-L deltaT) would underflow:  two half steps
+        propagate(Ca, deltaT/2);
+        propagate(Ca, deltaT/2);
+        return;
+    }
+    
+    double V[6] = { V0Ca, V1Ca, V2Ca, V3Ca, V4Ca, V5Ca };
+    double x[6], sum[6];
+    
+    double w = exp(-L*deltaT);   // Poisson weight of term n
+    double W = w;                // sum of the weights so far
+    
+    for(int k=0; k < 6; ++k) {
+        sum[k] = w*V[k];
+    }
+    
+    for(int n=1; W < 1 - 1e-12 && n < 1000; ++n)
+    {
+        for(int k=0; k < 6; ++k)   // V = P V
+        {
+            x[k] = V[k] - (up[k] + down[k])*V[k]/L;
+            
+            if (k > 0) x[k] += up[k-1]*V[k-1]/L;
+            if (k < 5) x[k] += down[k+1]*V[k+1]/L;
+        }
+        w *= L*deltaT/n;
+        W += w;
+        
+        for(int k=0; k < 6; ++k) {
+            V[k] = x[k];
+            sum[k] += w*V[k];
+        }
+    }
+    V0Ca = sum[0]/W;  V1Ca = sum[1]/W;  V2Ca = sum[2]/W;
+    V3Ca = sum[3]/W;  V4Ca = sum[4]/W;  V5Ca = sum[5]/W;
+}
+
+
 
-double release(int i, EX ex, double Vm, double Vrest, double Ca, double AP5)
+double release(int i, EX & ex, double Vm, double Vrest, double Ca, double AP5)
 {
  
 double x_factor=2000; 
@@ -163,24 +265,30 @@ Ca_MD[i]= Ca + x_factor;  // nM
 Ca = (Ca + x_factor)* pow(10,-9);      
  
 
-double fr=0;
-
 // ASSUMPTIONS:  no vesicle depletion, no spontaneous release.
-    
-do
+
+if (ex.integrator != INTEGRATOR_EULER)
+{
+    if (primed == 0) {
+        steady_state(Ca);
+        primed = 300;
+    }
+    propagate(Ca, ex.deltaT);
+}
+else do
 {
 
 double dV0Ca =                      koff*V1Ca             - 5*kon *Ca*V0Ca;
 
-double dV1Ca = 5* kon *Ca*V0Ca -    koff * V1Ca           - 4*kon*Ca*V1Ca + 2* koff * pow(b,1) *V2Ca;
+double dV1Ca = 5* kon *Ca*V0Ca -    koff * V1Ca           - 4*kon*Ca*V1Ca + 2* koff * ipow<1>(b) *V2Ca;
 
-double dV2Ca = 4* kon *Ca*V1Ca - 2* koff * pow(b,1) *V2Ca - 3*kon*Ca*V2Ca + 3* koff * pow(b,2) * V3Ca;
+double dV2Ca = 4* kon *Ca*V1Ca - 2* koff * ipow<1>(b) *V2Ca - 3*kon*Ca*V2Ca + 3* koff * ipow<2>(b) * V3Ca;
 
-double dV3Ca = 3* kon *Ca*V2Ca - 3* koff * pow(b,2) *V3Ca - 2*kon*Ca*V3Ca + 4* koff * pow(b,3) * V4Ca;
+double dV3Ca = 3* kon *Ca*V2Ca - 3* koff * ipow<2>(b) *V3Ca - 2*kon*Ca*V3Ca + 4* koff * ipow<3>(b) * V4Ca;
 
-double dV4Ca = 2* kon *Ca*V3Ca - 4* koff * pow(b,3) *V4Ca -   kon*Ca*V4Ca + 5* koff * pow(b,4) * V5Ca;
+double dV4Ca = 2* kon *Ca*V3Ca - 4* koff * ipow<3>(b) *V4Ca -   kon*Ca*V4Ca + 5* koff * ipow<4>(b) * V5Ca;
 
-double dV5Ca =    kon *Ca*V4Ca - 5* koff * pow(b,4) *V5Ca;
+double dV5Ca =    kon *Ca*V4Ca - 5* koff * ipow<4>(b) *V5Ca;
 
 
 V0Ca = V0Ca+  ex.deltaT *dV0Ca;
@@ -197,13 +305,13 @@ if (V3Ca < 0)  { V3Ca=0; }
 if (V4Ca < 0)  { V4Ca=0; }  
 if (V5Ca < 0)  { V5Ca=0; }
 
-
-// fr is the fusion rate per ms.  Max fr is 6 times the total number of vesicles.
-fr = I*V0Ca + I*f*V1Ca  +I*pow(f,2)*V2Ca +I*pow(f,3)*V3Ca + I*pow(f,4)*V4Ca + I*pow(f,5)*V5Ca;
-
 primed+=1;   // prime vesicles for 15 ms to put them in steady state for initial [Ca]i
 
 } while ( primed < 300 ); 
+
+
+// fr is the fusion rate per ms.  Max fr is 6 times the total number of vesicles.
+double fr = I*V0Ca + I*f*V1Ca  +I*ipow<2>(f)*V2Ca +I*ipow<3>(f)*V3Ca + I*ipow<4>(f)*V4Ca + I*ipow<5>(f)*V5Ca;
     
     
 // convert fr to percent of max
@@ -228,6 +336,7 @@ if ( ex.t[i] - lastSpike > 6.34  &&   Vm > -40 )
 { 
     ++spikes;
     lastSpike = ex.t[i];
+    spike_release.begin(lastRelease);
 }
 
 
@@ -239,12 +348,12 @@ if ( (ex.t[i] - lastSpike) <= window )
    synch = 1;
 }
 
-pr = (pr * ex.deltaT);     // per ms
+pr = step_probability(pr, ex);     // per time step
 
-double rv = rnd();
+double rv = (ex.hazard || ex.meanfield) ? 0 : rng.uniform();   // ex.hazard:  see HazardRelease
 
 
-if ( synch > 0 && rv < pr  &&  ex.t[i] - lastRelease  > 6.34 ) {
+if ( ! ex.meanfield  &&  synch > 0  &&  ex.t[i] - lastRelease  > 6.34  &&  (ex.hazard ? sampler.step(i, pr, rng, ex) : rv < pr) ) {
     RRP[i]=0.5;       // one vesicle is released
     lastRelease = ex.t[i];    
     vesiclesReleased +=1;
@@ -255,14 +364,34 @@ else {
     VR_event[i]=0;
 }
 
+if (exact_condition(ex, AP5)) {   // the probability of the event instead, for the bars
+    VR_event[i] = exact.step(ex.t[i], (synch > 0) ? pr : 0);
+    
+    if (ex.meanfield) {            // ... and for the glutamate
+        RRP[i] = 0.5*VR_event[i];
+    }
+}
+else if (ex.rb) {                 // ... or its expectation given the trial so far
+    VR_event[i] = (synch > 0) ? spike_release.step(ex.t[i], pr) : 0;
+}
+
 // Fraction of Neuronal Synaptic vesicles in releasable, effective
 // and inactive states respectively
 R_syn[i+1]=1; // R_syn[i]+ex.deltaT*(((I_syn[i])/tau_rec)-((RRP[i])*R_syn[i]));
-E_syn[i+1]=E_syn[i]+ex.deltaT*(((RRP[i])*R_syn[i])-(E_syn[i]/tau_inact));  // RRP[i] = {0,0.5, 1.0}
+if (ex.integrator == INTEGRATOR_EULER) {
+    E_syn[i+1]=E_syn[i]+ex.deltaT*(((RRP[i])*R_syn[i])-(E_syn[i]/tau_inact));  // RRP[i] = {0,0.5, 1.0}
+} else {
+    // a release adds the same dose whatever the time step
+    E_syn[i+1]= E_syn[i]*exp(-ex.deltaT/tau_inact) + RRP[i]*R_syn[i]*REFERENCE_DT;
+}
 //I_syn[i+1]=1-R_syn[i+1]-E_syn[i+1];
 
 // Glutamate in the synaptic cleft
-G_syn[i+1]=G_syn[i]+ex.deltaT*(nv*gv*E_syn[i]-degG*(G_syn[i]));
+if (ex.integrator == INTEGRATOR_EULER) {
+    G_syn[i+1]=G_syn[i]+ex.deltaT*(nv*gv*E_syn[i]-degG*(G_syn[i]));
+} else {
+    G_syn[i+1]= relax(G_syn[i], nv*gv*E_syn[i], 0, 1/degG, ex);
+}
 
 return G_syn[i+1];
 }
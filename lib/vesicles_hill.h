@@ -40,6 +40,11 @@ Ka = on-rate/off-rate
 #include "utilities.h"
 #endif
 
+#ifndef _exact_h_included_
+#define _exact_h_included_
+#include "exact.h"
+#endif
+
 class Vesicle_Hill
 {
 public:
@@ -60,21 +65,33 @@ double tau_rec;  // Vesicle recovery time constant; ms; Tsodyks & Markram (1997)
 
 static constexpr double tau_inact=3;  // Vesicle inactivation time constant; ms; Tsodyks & Markram (1997)
 
-double *     R_syn;     // Releasable fraction of vesicles
-double *     E_syn;     // Effective fraction of vesicles in synaptic cleft
-double *     I_syn;     // Inactivated fraction of vesicles
-double *     G_syn;     // Glutamate concentration in cleft;  mM
+static constexpr double Pr_max=0.90;      // release rate at saturating [Ca], per ms
+static constexpr double refractory=6.34;  // ms:  no spike, and no release, within it of the last
+static constexpr double window=5;         // ms:  release only within it of a spike, see release()
+static constexpr double G_rest=1e-3;      // Glutamate concentration in cleft at the start;  mM
+
+Trace     R_syn;     // Releasable fraction of vesicles
+Trace     E_syn;     // Effective fraction of vesicles in synaptic cleft
+Trace     I_syn;     // Inactivated fraction of vesicles
+Trace     G_syn;     // Glutamate concentration in cleft;  mM
 
-double * REL;  // vesicles released from the RRP
-double * RRP;
+Trace REL;  // vesicles released from the RRP
+Trace RRP;
 
-double * P_release;
-double * P_release_BLOCKER;
+Trace P_release;
+Trace P_release_BLOCKER;
 
-double * VR_event;
-double * AP_event;
+Trace VR_event;
+Trace AP_event;
 
-double * Ca_MD;   // [Ca] in the microdomain of the vesicle
+Trace Ca_MD;   // [Ca] in the microdomain of the vesicle
+
+Random rng;       // random numbers for this vesicle, seeded for each trial
+
+static constexpr int EXACT=1;   // no random state:  exact release probabilities, see exact.h
+ExactRelease exact;
+WindowRelease spike_release;   // ex.rb
+HazardRelease sampler;         // ex.hazard
 
 double lastRelease;          // Time of most recent vesicle release (ms)
 
@@ -90,21 +107,21 @@ Vesicle_Hill(){ ; }
 
 Vesicle_Hill(int tn)
 { 
-    R_syn=init_double(tn+2); 
-    E_syn=init_double(tn+2); 
-    I_syn=init_double(tn+2); 
-    G_syn=init_double(tn+2);  
+    R_syn=Trace(tn); 
+    E_syn=Trace(tn); 
+    I_syn=Trace(tn); 
+    G_syn=Trace(tn);  
     
-    REL=init_double(tn+2);
-    RRP=init_double(tn+2);
+    REL=Trace(tn);
+    RRP=Trace(tn);
     
-    P_release=init_double(tn+2); 
-    P_release_BLOCKER=init_double(tn+2); 
+    P_release=Trace(tn); 
+    P_release_BLOCKER=Trace(tn); 
      
-    VR_event=init_double(tn+2); 
-    AP_event=init_double(tn+2);   
+    VR_event=Trace(tn); 
+    AP_event=Trace(tn);   
     
-    Ca_MD=init_double(tn+2); 
+    Ca_MD=Trace(tn); 
 };
 
 
@@ -134,7 +151,7 @@ void set(int tn) {
     
     tau_rec=800;    // Vesicle recovery time constant; ms; Tsodyks & Markram (1997)
     
-    G_syn[1]=1e-3;  // Glutamate concentration in cleft;  mM
+    G_syn[1]=G_rest;
     
     lastRelease=-100;
     vesiclesReleased=0;
@@ -143,11 +160,15 @@ void set(int tn) {
     
     spikes=0;
     lastSpike=-100;
+    
+    exact.reset();
+    spike_release.reset();
+    sampler.reset();
 };
 
 
     
-double release(int i, EX ex, double Vm, double vr, double Ca, double AP5)
+double release(int i, EX & ex, double Vm, double vr, double Ca, double AP5)
 {
 
 double x_factor=000;
@@ -175,15 +196,15 @@ double n=ex.n1,  Kd=ex.Kd1;
 
 RRP[i] = 1;  // floor(num_docked);            
 
-double Pr_max = 0.90;  //  1 - pow((1-Vpr), RRP[i]);
+// Pr_max:  1 - pow((1-Vpr), RRP[i]);
 
 // Synaptotagmin 1: low affinity calcium sensor triggers vesicle fusion and release
-double Pr1 =  pow(Ca,n) / (pow(Kd,n) + pow(Ca,n));
+double Pr1 =  hill(Ca, Kd, n);
 
 // Second sensor: a very low affinity calcium sensor (opposes release)
 n = ex.n2;   Kd = ex.Kd2; 
 
-double Pr2 = pow(Kd,n) / (pow(Kd,n) + pow(Ca,n));
+double Pr2 = hill_inhibition(Ca, Kd, n);
 
 double Pr = Pr_max * Pr1; // * Pr2;
 
@@ -200,14 +221,15 @@ else {
 
 
 // Refractory period of 6.34 ms. 
-if ( ex.t[i] - lastSpike > 6.34  &&   Vm > -40 )  
+if ( ex.t[i] - lastSpike > refractory  &&   Vm > -40 )  
 { 
     ++spikes;
     lastSpike = ex.t[i];   // vesicle release window starts at beginning of most recent spike
+    spike_release.begin(lastRelease);
 }
 
 
-double window=5;      // p678 Meinrenken 2003:  [Ca]avg_vesicle peaks at 8 uM and decays to 400 nM, 
+// window, 5 ms:        p678 Meinrenken 2003:  [Ca]avg_vesicle peaks at 8 uM and decays to 400 nM, 
                       // predicted avg Pr (after 5ms) is 25%
 int synch = 0;
 
@@ -216,11 +238,13 @@ if ( (ex.t[i] - lastSpike) <= window )
    synch = 1;
 }
 
-Pr = (Pr * ex.deltaT);  // Pr per time step
+Pr = step_probability(Pr, ex);  // Pr per time step
 
 // ASSUMPTIONS:  no spontaneous release.   vesicle depletion versus no vesicle depletion?
 
-if ( synch == 1  && (ex.t[i] - lastRelease) > 6.34 && RRP[i] >= 1 && rnd() < Pr )  
+// ex.paired:  the number of step i, so both conditions draw the same ones;  ex.hazard:  see HazardRelease
+if ( ! ex.meanfield && synch == 1  && (ex.t[i] - lastRelease) > refractory && RRP[i] >= 1 && 
+     (ex.hazard ? sampler.step(i, Pr, rng, ex) : (ex.paired ? rng.at(i) : rng.uniform()) < Pr) )  
 {
    lastRelease = ex.t[i];    
    vesiclesReleased +=1;  
@@ -235,6 +259,18 @@ else
    REL[i]=0;
 }
 
+if (exact_condition(ex, AP5)) {   // the probability of the event instead, for the bars
+   VR_event[i] = exact.step(ex.t[i], (synch == 1 && RRP[i] >= 1) ? Pr : 0);
+   
+   if (ex.meanfield) {            // ... and for the glutamate
+      REL[i] = VR_event[i];
+      num_docked -= REL[i];
+   }
+}
+else if (ex.rb) {                 // ... or its expectation given the trial so far
+   VR_event[i] = (synch == 1) ? spike_release.step(ex.t[i], (RRP[i] >= 1) ? Pr : 0) : 0;
+}
+
 
 num_docked = num_docked + ex.deltaT * ( (max_docked - num_docked)/tau_rec ) * (Ca - 0.100)/(Ca + 0.100);
 
@@ -251,11 +287,20 @@ num_docked = num_docked + ex.deltaT * ( (max_docked - num_docked)/tau_rec ) * (C
 // Fraction of Neuronal Synaptic vesicles in releasable, effective
 // and inactive states respectively
 R_syn[i+1]= 1;  // R_syn[i]+ex.deltaT*(((I_syn[i])/tau_rec)-((REL[i])*R_syn[i])); // 1
-E_syn[i+1]= E_syn[i]+ex.deltaT*( ( REL[i]*R_syn[i] )-(E_syn[i]/tau_inact) );  // REL[i] = {0,1.0}
+if (ex.integrator == INTEGRATOR_EULER) {
+    E_syn[i+1]= E_syn[i]+ex.deltaT*( ( REL[i]*R_syn[i] )-(E_syn[i]/tau_inact) );  // REL[i] = {0,1.0}
+} else {
+    // a release adds the same dose whatever the time step
+    E_syn[i+1]= E_syn[i]*exp(-ex.deltaT/tau_inact) + REL[i]*R_syn[i]*REFERENCE_DT;
+}
 I_syn[i+1]= 1-R_syn[i+1]-E_syn[i+1];
 
 // Glutamate in the synaptic cleft
-G_syn[i+1]= G_syn[i]+ex.deltaT*(nv*gv*E_syn[i]-degG*(G_syn[i]));
+if (ex.integrator == INTEGRATOR_EULER) {
+    G_syn[i+1]= G_syn[i]+ex.deltaT*(nv*gv*E_syn[i]-degG*(G_syn[i]));
+} else {
+    G_syn[i+1]= relax(G_syn[i], nv*gv*E_syn[i], 0, 1/degG, ex);
+}
 
 
 return G_syn[i+1];
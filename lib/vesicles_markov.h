@@ -27,14 +27,14 @@ static constexpr double tau_rec=800;  // Vesicle recovery time constexprant;  ms
 static constexpr double tau_inact=3;  // Vesicle inactivation time constexprant;  ms;   Tsodyks & Markram (1997)
  
  
-int * x1;  // Temporal evolution of synaptic vesicle 1
-int * x2;  // Temporal evolution of synaptic vesicle 2
+TraceInt x1;  // Temporal evolution of synaptic vesicle 1
+TraceInt x2;  // Temporal evolution of synaptic vesicle 2
 
-double * G_syn;  // Synaptic glutamate concentration
-double * R_syn;  // Fraction of releasable vesicles
-double * E_syn;  // Fraction of effective vesicles in synaptic cleft
-double * I_syn;  // Fraction of inactivated vesicles 
-double * RRP;    // Vesicles released from RRP
+Trace G_syn;  // Synaptic glutamate concentration
+Trace R_syn;  // Fraction of releasable vesicles
+Trace E_syn;  // Fraction of effective vesicles in synaptic cleft
+Trace I_syn;  // Fraction of inactivated vesicles 
+Trace RRP;    // Vesicles released from RRP
 
 double lastRelease;      // Time of most recent vesicle release (ms)
 
@@ -43,14 +43,22 @@ double lastSpike;
 
 int vesiclesReleased;
 
-double * P_release;
-double * P_release_BLOCKER;
+Trace P_release;
+Trace P_release_BLOCKER;
 
-double * VR_event;
-double * AP_event;
+Trace VR_event;
+Trace AP_event;
 
-double * Ca_MD;
+Trace Ca_MD;
 
+Random rng;       // random numbers for this vesicle, seeded for each trial
+
+static constexpr int EXACT=0;   // random states:  no exact release probabilities (see exact.h)
+
+// ex.ssa:  rate out of its state integrated since vesicle k entered it, and 
+// the Exp(1) threshold at which it leaves;  -1: not drawn yet.
+double hazard[2];
+double threshold[2];
 
 
 Vesicle_Markov()
@@ -62,22 +70,22 @@ Vesicle_Markov()
 Vesicle_Markov(int tn)
 {    
     // allocate memory
-    x1=init_int(tn+2);  
-    x2=init_int(tn+2);    
+    x1=TraceInt(tn);  
+    x2=TraceInt(tn);    
     
-    Ca_MD =init_double(tn+2); 
+    Ca_MD =Trace(tn); 
     
-    G_syn=init_double(tn+2); 
-    R_syn=init_double(tn+2);  
-    E_syn=init_double(tn+2);  
-    I_syn=init_double(tn+2);  
-    RRP=init_double(tn+2);  
+    G_syn=Trace(tn); 
+    R_syn=Trace(tn);  
+    E_syn=Trace(tn);  
+    I_syn=Trace(tn);  
+    RRP=Trace(tn);  
     
-    P_release        =init_double(tn+2);
-    P_release_BLOCKER=init_double(tn+2);
+    P_release        =Trace(tn);
+    P_release_BLOCKER=Trace(tn);
 
-    VR_event=init_double(tn+2); 
-    AP_event=init_double(tn+2); 
+    VR_event=Trace(tn); 
+    AP_event=Trace(tn); 
 }
 
 // set values for next trial
@@ -113,14 +121,85 @@ void set(int tn) {
     // initialise values
     double mu[8]={0, 1, 0, 0, 0, 0, 0};  // Inital vector for vesicle '1' & '2.' 
     
-    x1[1]=markov(mu);
-    x2[1]=markov(mu);  // Initial state of synaptic vesicle
+    x1[1]=markov(mu, rng.uniform());
+    x2[1]=markov(mu, rng.uniform());  // Initial state of synaptic vesicle
+    
+    for(int k=0; k < 2; ++k) {
+        hazard[k]=0;
+        threshold[k]=-1;
+    }
+}
+
+
+// Rates (per ms) out of state x = 1 .. 7 at calcium ca (uM):  five calcium 
+// binding steps up to 6, isomerization to 7;  back down with koff and delta.
+// The off-diagonal elements of the transition matrix are these times deltaT.
+//
+static void rates(int x, double ca, double & up, double & down)
+{
+    up   = (x < 6) ? (6-x)*kon*ca : (x == 6 ? Gamma : 0);
+    down = (x < 7) ? (x-1)*koff   : delta;
+}
+
+// Next state from x, one time step with uniform u:  the column of x in the
+// transition matrix has three entries, down, stay and up, taken in the order 
+// markov() scans them.
+//
+static int step(int x, double ca, double deltaT, double u)
+{
+    double up, down;
+    rates(x, ca, up, down);
+    
+    up   = up*deltaT;
+    down = down*deltaT;
+    
+    double stay = 1-down-up;
+    
+    if (x > 1 && u <= down) {
+        return x-1;
+    }
+    if (u <= down + stay) {
+        return x;
+    }
+    return (x < 7) ? x+1 : 7;
+}
+
+// State at the end of a time step from x, exact stochastic simulation:  the 
+// vesicle jumps when its integrated rate out reaches an Exp(1) threshold, 
+// with the rates held over the step, as ca is.  Random numbers are drawn only
+// at jumps, none while the vesicle stays put.
+//
+int jump(int x, double ca, double deltaT, double & hazard, double & threshold)
+{
+    if (threshold < 0) {
+        threshold = rng.exponential();
+    }
+    double left = deltaT;   // of this step
+    
+    for(;;)
+    {
+        double up, down;
+        rates(x, ca, up, down);
+        
+        double out = up + down;
+        
+        if (hazard + out*left < threshold) {
+            hazard += out*left;
+            return x;
+        }
+        left -= (threshold - hazard)/out;
+        
+        x = (rng.uniform()*out < down) ? x-1 : x+1;
+        
+        hazard = 0;
+        threshold = rng.exponential();
+    }
 }
 
 
 // VGCC, preNMDAR and RyR calcium are included in [Ca] at vesicle's calcium sensor.
 //
-double release(int i, EX ex, double Vm, double Vrest, double ca, double AP5)
+double release(int i, EX & ex, double Vm, double Vrest, double ca, double AP5)
 {
 double x_factor=2000;
 
@@ -130,52 +209,18 @@ Ca_MD[i]= ca;   // in nM, and saved as nM for plotting
 
 ca = ca/1000;   // convert from nM to uM because Markov model assumes uM;
  
-// Transition probability matrix 'PM', using 1 as first element, so ignoring PM[0][0]
-double a21=5* kon * ca * ex.deltaT;
-double a12=koff*ex.deltaT;
-double a32=4*kon* ca *ex.deltaT;
-double a23=2*koff*ex.deltaT;
-double a43=3*kon* ca *ex.deltaT;
-double a34=3*koff*ex.deltaT;
-double a54=2*kon* ca *ex.deltaT;
-double a45=4*koff*ex.deltaT;
-double a65=kon*   ca *ex.deltaT;
-double a56=5*koff*ex.deltaT;
-double a76=Gamma*ex.deltaT;
-double a67=delta*ex.deltaT;
-// Diagonal elements
-double D0=1-a21;
-double D1=1-a12-a32;
-double D2=1-a23-a43;
-double D3=1-a34-a54;
-double D4=1-a45-a65;
-double D5=1-a56-a76;
-double D6=1-a67;
-
-
-double PM[8][8] = {{0,0,0,0,     0,0,0,0},
-                  {0,D0,a12,0,  0,0,0,0},
-                  {0,a21,D1,a23,0,0,0,0},
-                  {0,0,a32,D2,  a34,0,0,0},
-                  {0,0,0,a43,   D3,a45,0,0},
-                  {0,0,0,0,     a54,D4,a56,0},
-                  {0,0,0,0,     0,a65,D5,a67},
-                  {0,0,0,0,     0,0,a76,D6 } };
-
-int j=0;
-
-double mm1[8];
-double mm2[8];
-
-for(j=1; j < 8; ++j)   // row j,  col x1[i]
+// Transition probability matrix:  tridiagonal, see rates(), so only the 
+// column of the present state is needed.
+if (ex.ssa)
 {
-   mm1[j] = PM[j][x1[i]];
-   mm2[j] = PM[j][x2[i]];
-   //printf("%f,  %f\n", mm1[j], mm2[j]);
+    x1[i+1]=jump( x1[i], ca, ex.deltaT, hazard[0], threshold[0] );
+    x2[i+1]=jump( x2[i], ca, ex.deltaT, hazard[1], threshold[1] );
+}
+else
+{
+    x1[i+1]=step( x1[i], ca, ex.deltaT, rng.uniform() );  // State vector for 1st vesicle
+    x2[i+1]=step( x2[i], ca, ex.deltaT, rng.uniform() );  // State vector for 2nd vesicle
 }
-
-x1[i+1]=markov( mm1 );  // State vector for 1st vesicle
-x2[i+1]=markov( mm2 );  // State vector for 2nd vesicle
     
 
 // Refractory period of 6.34 ms. 
@@ -227,11 +272,20 @@ else {
 // Fraction of Neuronal Synaptic vesicles in releasable, effective and inactive states respectively.
 //
 R_syn[i+1]=1;    // R_syn[i]+ex.deltaT*(((I_syn[i])/tau_rec)-((RRP[i])*R_syn[i]));
-E_syn[i+1]=E_syn[i]+ex.deltaT*(((RRP[i])*R_syn[i])-(E_syn[i]/tau_inact));  // RRP[i] = {0,0.5, 1.0}
+if (ex.integrator == INTEGRATOR_EULER) {
+    E_syn[i+1]=E_syn[i]+ex.deltaT*(((RRP[i])*R_syn[i])-(E_syn[i]/tau_inact));  // RRP[i] = {0,0.5, 1.0}
+} else {
+    // a release adds the same dose whatever the time step
+    E_syn[i+1]= E_syn[i]*exp(-ex.deltaT/tau_inact) + RRP[i]*R_syn[i]*REFERENCE_DT;
+}
 //I_syn[i+1]=1-R_syn[i+1]-E_syn[i+1];
 
 // Glutamate in the synaptic cleft:
-G_syn[i+1]=G_syn[i]+ex.deltaT*(nv*gv*E_syn[i]-degG*(G_syn[i]));
+if (ex.integrator == INTEGRATOR_EULER) {
+    G_syn[i+1]=G_syn[i]+ex.deltaT*(nv*gv*E_syn[i]-degG*(G_syn[i]));
+} else {
+    G_syn[i+1]= relax(G_syn[i], nv*gv*E_syn[i], 0, 1/degG, ex);
+}
 
 return G_syn[i+1];
 }
@@ -32,11 +32,11 @@ static constexpr double tau_inact=3;  // Vesicle inactivation time constexprant;
 
 double Xn;
 
-double * G_syn;  // Synaptic glutamate conceVesicle_Markov_6ntration
-double * R_syn;  // Fraction of releasable vesicles
-double * E_syn;  // Fraction of effective vesicles in synaptic cleft
-double * I_syn;  // Fraction of inactivated vesicles 
-double * RRP;    // Vesicles released from RRP
+Trace G_syn;  // Synaptic glutamate conceVesicle_Markov_6ntration
+Trace R_syn;  // Fraction of releasable vesicles
+Trace E_syn;  // Fraction of effective vesicles in synaptic cleft
+Trace I_syn;  // Fraction of inactivated vesicles 
+Trace RRP;    // Vesicles released from RRP
 
 double lastRelease;      // Time of most recent vesicle release (ms)
 
@@ -45,14 +45,22 @@ double lastSpike;
 
 int vesiclesReleased;
 
-double * P_release;
-double * P_release_BLOCKER;
+Trace P_release;
+Trace P_release_BLOCKER;
 
-double * VR_event;
-double * AP_event;
+Trace VR_event;
+Trace AP_event;
 
-double * Ca_MD;
+Trace Ca_MD;
 
+Random rng;       // random numbers for this vesicle, seeded for each trial
+
+static constexpr int EXACT=0;   // random states:  no exact release probabilities (see exact.h)
+
+// ex.ssa:  rate out of Xn integrated since the vesicle entered it, and the
+// Exp(1) threshold at which it leaves;  -1: not drawn yet.
+double hazard;
+double threshold;
 
 Vesicle_Markov_6()
 {
@@ -64,19 +72,19 @@ Vesicle_Markov_6(int tn)
 {    
     Xn=0;
     
-    Ca_MD =init_double(tn+2); 
+    Ca_MD =Trace(tn); 
     
-    G_syn=init_double(tn+2); 
-    R_syn=init_double(tn+2);  
-    E_syn=init_double(tn+2);  
-    I_syn=init_double(tn+2);  
-    RRP  =init_double(tn+2);  
+    G_syn=Trace(tn); 
+    R_syn=Trace(tn);  
+    E_syn=Trace(tn);  
+    I_syn=Trace(tn);  
+    RRP  =Trace(tn);  
     
-    P_release        =init_double(tn+2);
-    P_release_BLOCKER=init_double(tn+2);
+    P_release        =Trace(tn);
+    P_release_BLOCKER=Trace(tn);
 
-    VR_event=init_double(tn+2); 
-    AP_event=init_double(tn+2); 
+    VR_event=Trace(tn); 
+    AP_event=Trace(tn); 
 };
 
 // set values for next trial
@@ -110,13 +118,79 @@ void set(int tn) {
     vesiclesReleased=0;
     
     Xn=0;
+    hazard=0;
+    threshold=-1;
 };
 
 
+// Binding rate (per ms) from Xn at calcium ca (uM):  calcium binds to the
+// 5 - Xn free sites with kon.
+//
+static double binding(double Xn, double ca)
+{
+    return (Xn < 5) ? (5 - Xn) * kon * ca : 0;
+}
+
+// Probabilities of going up (right) and down (left) from Xn within a time
+// step, at calcium ca (uM):  the binding rate times deltaT saturating with
+// K_step, the unbinding rate Xn koff times deltaT.
+//
+static constexpr double K_step=0.7;
+
+static void probabilities(double Xn, double ca, double deltaT, double & right, double & left)
+{
+    right = (Xn < 5) ? hill<1>(binding(Xn, ca) * deltaT, K_step) : 0;
+    left  = Xn * koff * deltaT;
+}
+
+// Rates (per ms) of going up and down from Xn at calcium ca (uM), the limit
+// of probabilities()/deltaT as deltaT -> 0:  hill<1>(x, K_step) is x/K_step
+// for small x, so the chain binds at binding()/K_step.
+//
+static void rates(double Xn, double ca, double & up, double & down)
+{
+    up   = binding(Xn, ca) / K_step;
+    down = Xn * koff;
+}
+
+// Xn at the end of a time step, exact stochastic simulation:  the rates(), 
+// held over the step as ca is;  Xn moves when the rate out of it, integrated,
+// reaches an Exp(1) threshold.  Random numbers are drawn only when it moves.
+// This is the chain of probabilities() as deltaT -> 0, without the error of
+// the per-step saturation.
+//
+void jump(double ca, double deltaT)
+{
+    if (threshold < 0) {
+        threshold = rng.exponential();
+    }
+    double left_t = deltaT;   // of this step
+    
+    for(;;)
+    {
+        double up, down;
+        rates(Xn, ca, up, down);
+        
+        double out = up + down;
+        
+        if (hazard + out*left_t < threshold) {
+            hazard += out*left_t;
+            return;
+        }
+        left_t -= (threshold - hazard)/out;
+        
+        Xn += (rng.uniform()*out < up) ? 1 : -1;
+        
+        hazard = 0;
+        threshold = rng.exponential();
+    }
+}
+
+
 // VGCC, preNMDAR and RyR calcium are included in [Ca] at vesicle's calcium sensor.
 //
 //
-double release(int i, EX ex, double Vm, double Vrest, double ca, double AP5)
+double release(int i, EX & ex, double Vm, double Vrest, double ca, double AP5)
 {
 
 double x_factor=0;
@@ -127,36 +201,28 @@ Ca_MD[i]= ca;   // in nM, and saved as nM for plotting
 
 ca = ca/1000;   // convert to uM
 
-double right=0; double left=0;      // Transition probabilities
- 
+double right, left;      // Transition probabilities, per time step
  
-if (Xn == 0) {
-    right = 5 * kon * ca * ex.deltaT;
-    right = pow(right,1)/(0.7 + pow(right,1));
-}   
-else if (Xn > 0 && Xn < 5) {
-
-    right = (5 - Xn) * kon * ca * ex.deltaT;
-    right = pow(right,1)/(0.7 + pow(right,1));
-    
-    left  = Xn  * koff* ex.deltaT;
-}
-else {
-    left = 5*koff* ex.deltaT;
-}
+probabilities(Xn, ca, ex.deltaT, right, left);
 
 
 
 
 double window = 5; // synchronous vesicle release must be within short time window after spike
 
-double rn=rnd();
-
-if (rn < right) {
-   Xn = Xn + 1;
+if (ex.ssa) {
+   jump(ca, ex.deltaT);
 }
-else if (rn < (right + left) )  {
-   Xn = Xn - 1;
+else
+{
+   double rn=rng.uniform();
+
+   if (rn < right) {
+      Xn = Xn + 1;
+   }
+   else if (rn < (right + left) )  {
+      Xn = Xn - 1;
+   }
 }
 
 
@@ -207,11 +273,20 @@ else {
 // Fraction of Neuronal Synaptic vesicles in releasable, effective and inactive states respectively.
 //
 R_syn[i+1]=1;    //R_syn[i]+ex.deltaT*(((I_syn[i])/tau_rec)-((RRP[i])*R_syn[i]));
-E_syn[i+1]=E_syn[i]+ex.deltaT*(((RRP[i])*R_syn[i])-(E_syn[i]/tau_inact));  // RRP[i] = {0,0.5, 1.0}
+if (ex.integrator == INTEGRATOR_EULER) {
+    E_syn[i+1]=E_syn[i]+ex.deltaT*(((RRP[i])*R_syn[i])-(E_syn[i]/tau_inact));  // RRP[i] = {0,0.5, 1.0}
+} else {
+    // a release adds the same dose whatever the time step
+    E_syn[i+1]= E_syn[i]*exp(-ex.deltaT/tau_inact) + RRP[i]*R_syn[i]*REFERENCE_DT;
+}
 //I_syn[i+1]=1-R_syn[i+1]-E_syn[i+1];
 
 // Glutamate in the synaptic cleft:
-G_syn[i+1]=G_syn[i]+ex.deltaT*(nv*gv*E_syn[i]-degG*(G_syn[i]));
+if (ex.integrator == INTEGRATOR_EULER) {
+    G_syn[i+1]=G_syn[i]+ex.deltaT*(nv*gv*E_syn[i]-degG*(G_syn[i]));
+} else {
+    G_syn[i+1]= relax(G_syn[i], nv*gv*E_syn[i], 0, 1/degG, ex);
+}
 
 return G_syn[i+1];
 };
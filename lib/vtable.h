@@ -0,0 +1,148 @@
+//! Voltage tables
+/*!
+  The Hodgkin-Huxley rates of the bouton, the VGCC activation mcinf and the
+  Mg++ unblock exp(-0.062 v) of the NMDA receptors depend on the membrane
+  potential only.  With ex.tables they are read from one table instead of
+  being computed with exp() at every time step.
+
+  The table holds every function at V_MIN, V_MIN+STEP, ... V_MAX, all the
+  functions of a node next to each other (one cache line), and interpolates
+  linearly in between.  Outside [V_MIN, V_MAX] the functions are computed.
+  When it is built the table checks itself half way between every two nodes,
+  where the error of linear interpolation is largest:  if any function is
+  off by more than TOLERANCE (relative) the program stops, so every value it
+  returns is within TOLERANCE of voltage_function().
+
+  It is built once, the first time voltage_table() is called, and only read
+  afterwards, so all the worker threads share it.
+
+  It pays off only when the membrane is integrated in every trial (hoist=0),
+  and then by a few percent.  With hoist=1 the membrane is integrated once
+  per experiment and the tables make no measurable difference;  the lookups
+  hit a few neighbouring nodes only, so a coarser STEP does not help either.
+*/
+
+#ifndef _math_h_included_
+#define _math_h_included_
+#include <math.h>
+#endif
+
+#ifndef _stdlib_h_included_
+#define _stdlib_h_included_
+#include <stdlib.h>
+#endif
+
+#ifndef _stdio_h_included_
+#define _stdio_h_included_
+#include <stdio.h>
+#endif
+
+// The functions in the table.
+enum { VT_AN, VT_BN, VT_AM, VT_BM, VT_AH, VT_BH, VT_MCINF, VT_MG, VT_FUNCTIONS };
+
+// Function f at v (mV), computed;  defined in bouton.h.
+double voltage_function(int f, double v);
+
+
+class VoltageTable
+{
+public:
+
+static constexpr double V_MIN=-150;      // mV
+static constexpr double V_MAX= 100;
+static constexpr double STEP=0.01;
+static constexpr double TOLERANCE=1e-6;  // relative error, at most
+
+static constexpr int NODES = (int) ((V_MAX - V_MIN)/STEP + 0.5) + 1;
+
+double * x;     // function f at node k:  x[k*VT_FUNCTIONS + f]
+double error;   // largest relative error found when the table was built
+
+VoltageTable()
+{
+    x = new double[NODES * VT_FUNCTIONS];
+
+    for(int k=0; k < NODES; ++k) {
+        for(int f=0; f < VT_FUNCTIONS; ++f) {
+            double v = V_MIN + k*STEP;
+            double y = voltage_function(f, v);
+
+            if ( ! isfinite(y) ) {   // 0/0 of an and am:  their limit
+                y = (voltage_function(f, v - 1e-6) + voltage_function(f, v + 1e-6))/2;
+            }
+            x[k*VT_FUNCTIONS + f] = y;
+        }
+    }
+
+    error=0;
+    for(int k=0; k+1 < NODES; ++k)
+    {
+        double v = V_MIN + (k + 0.5)*STEP;
+
+        for(int f=0; f < VT_FUNCTIONS; ++f)
+        {
+            double exact = voltage_function(f, v);
+            double e = fabs((*this)(f, v) - exact)/fabs(exact);
+
+            if ( ! (e <= TOLERANCE) ) {
+                fprintf(stderr, "voltage table:  function %d is off by %g at %g mV\n", f, e, v);
+                exit(1);
+            }
+            if (e > error) {
+                error = e;
+            }
+        }
+    }
+}
+
+~VoltageTable()
+{
+    delete[] x;
+}
+
+// Function f at v.
+double operator()(int f, double v) const
+{
+    double u = (v - V_MIN)/STEP;
+
+    if ( ! (u >= 0 && u < NODES-1) ) {
+        return voltage_function(f, v);
+    }
+    int    k = (int) u;
+    double w = u - k;
+    const double * y = x + k*VT_FUNCTIONS;
+
+    return y[f] + w*(y[VT_FUNCTIONS + f] - y[f]);
+}
+
+// All the functions at v, y[VT_AN] ... y[VT_MG].
+void lookup(double v, double * y) const
+{
+    double u = (v - V_MIN)/STEP;
+
+    if ( ! (u >= 0 && u < NODES-1) )
+    {
+        for(int f=0; f < VT_FUNCTIONS; ++f) {
+            y[f] = voltage_function(f, v);
+        }
+        return;
+    }
+    int    k = (int) u;
+    double w = u - k;
+    const double * y0 = x + k*VT_FUNCTIONS;
+    const double * y1 = y0 + VT_FUNCTIONS;
+
+    for(int f=0; f < VT_FUNCTIONS; ++f) {
+        y[f] = y0[f] + w*(y1[f] - y0[f]);
+    }
+}
+};
+
+
+// The table shared by all simulations.
+//
+const VoltageTable & voltage_table()
+{
+    static VoltageTable table;
+    return table;
+}
@@ -0,0 +1,194 @@
+//! Background writer
+/*!
+  Output files are written by one dedicated thread, so a simulation does not
+  wait for its files to be formatted and flushed before it starts the next
+  condition or experiment.
+
+  submit(job) hands a job, which owns the finished buffers it saves, to the
+  writer thread through a bounded lock-free queue (Vyukov's array based
+  queue).  When all SLOTS are taken submit() waits for one to be freed, so at
+  most SLOTS sets of buffers are held in memory at any time (backpressure).
+  Jobs are run in the order they were submitted, so a file written twice ends
+  up with the last contents.  flush() returns once every job submitted so far
+  has been run.
+*/
+
+#ifndef _thread_included_
+#define _thread_included_
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+#endif
+
+#ifndef _stdint_h_included_
+#define _stdint_h_included_
+#include <stdint.h>
+#endif
+
+#ifndef _atomic_included_
+#define _atomic_included_
+#include <atomic>
+#include <chrono>
+#endif
+
+class Writer
+{
+public:
+
+static constexpr int SLOTS=16;   // jobs waiting to be written, at most
+
+Writer()
+{
+    for(int k=0; k < SLOTS; ++k) {
+        slots[k].seq = k;
+    }
+    head=0;
+    tail=0;
+    submitted=0;
+    done=0;
+    stop=0;
+
+    thread = std::thread(&Writer::loop, this);
+}
+
+~Writer()
+{
+    flush();
+
+    stop=1;
+    cv.notify_one();
+    thread.join();
+}
+
+// Queue job for the writer thread;  waits while the queue is full.
+void submit(std::function<void()> job)
+{
+    ++submitted;
+
+    while ( ! push(job) ) {
+        std::this_thread::sleep_for( std::chrono::microseconds(100) );
+    }
+    cv.notify_one();
+}
+
+// Wait until every job submitted so far has been run.
+void flush()
+{
+    while (done.load() != submitted.load()) {
+        std::this_thread::sleep_for( std::chrono::microseconds(100) );
+    }
+}
+
+
+private:
+
+struct Slot
+{
+    std::atomic<size_t> seq;   // = position when free to push, position+1 when full
+    std::function<void()> job;
+};
+
+Slot slots[SLOTS];
+
+std::atomic<size_t> head;   // next position to pop
+std::atomic<size_t> tail;   // next position to push
+
+std::atomic<size_t> submitted;
+std::atomic<size_t> done;
+std::atomic<int> stop;
+
+std::thread thread;
+
+std::mutex mtx;                // only for the writer thread to sleep on
+std::condition_variable cv;    // when there is nothing to write
+
+int push(std::function<void()> & job)
+{
+    size_t pos = tail.load(std::memory_order_relaxed);
+
+    for(;;)
+    {
+        Slot & slot = slots[pos % SLOTS];
+        intptr_t diff = (intptr_t) slot.seq.load(std::memory_order_acquire) - (intptr_t) pos;
+
+        if (diff == 0)
+        {
+            if (tail.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) {
+                slot.job = std::move(job);
+                slot.seq.store(pos+1, std::memory_order_release);
+                return 1;
+            }
+        }
+        else if (diff < 0) {
+            return 0;   // full
+        }
+        else {
+            pos = tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+int pop(std::function<void()> & job)
+{
+    size_t pos = head.load(std::memory_order_relaxed);
+
+    for(;;)
+    {
+        Slot & slot = slots[pos % SLOTS];
+        intptr_t diff = (intptr_t) slot.seq.load(std::memory_order_acquire) - (intptr_t) (pos+1);
+
+        if (diff == 0)
+        {
+            if (head.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) {
+                job = std::move(slot.job);
+                slot.job = nullptr;
+                slot.seq.store(pos+SLOTS, std::memory_order_release);
+                return 1;
+            }
+        }
+        else if (diff < 0) {
+            return 0;   // empty
+        }
+        else {
+            pos = head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void loop()
+{
+    std::function<void()> job;
+
+    for(;;)
+    {
+        if (pop(job))
+        {
+            job();
+            job = nullptr;
+            ++done;
+            continue;
+        }
+
+        if (stop) {
+            return;
+        }
+
+        // A submit() between pop() and wait_for() is picked up at the latest
+        // when the wait times out.
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait_for(lock, std::chrono::milliseconds(1));
+    }
+}
+};
+
+
+// The writer shared by all simulations.
+//
+Writer & output_writer()
+{
+    static Writer writer;
+    return writer;
+}
@@ -0,0 +1,47 @@
+function [T, run] = load_traces(filename)
+% LOAD_TRACES  Reads a binary trace file written by the C++ model,
+% e.g. csv/trace.bin (ACSF) or csv/trace_BLOCKER.bin.
+%
+% T.(name) is the trace of variable name, a row vector as load() gives for
+% csv/name.csv;  run.(field) holds the EX fields of the run (isi, deltaT, ...).
+%
+% The format is described in lib/save.h (class TraceSet).
+
+fid = fopen(filename, 'r', 'ieee-le');
+
+if fid < 0
+    error('cannot open %s', filename);
+end
+
+magic = fread(fid, [1 8], '*char');
+
+if ~strcmp(magic, 'STPTRACE')
+    fclose(fid);
+    error('%s is not a trace file', filename);
+end
+
+version = fread(fid, 1, 'uint32');   %#ok<NASGU>
+
+M = fread(fid, 1, 'uint32');
+for k=1:M
+    name = deblank(fread(fid, [1 32], '*char'));
+    run.(name) = fread(fid, 1, 'double');
+end
+
+N = fread(fid, 1, 'uint32');
+names = cell(1, N);
+lengths = zeros(1, N);
+for k=1:N
+    names{k}   = deblank(fread(fid, [1 32], '*char'));
+    lengths(k) = fread(fid, 1, 'uint64');
+end
+
+% the columns one after the other:  one read, then split
+data = fread(fid, [1 sum(lengths)], 'double');
+ends = cumsum(lengths);
+for k=1:N
+    T.(names{k}) = data(ends(k)-lengths(k)+1 : ends(k));
+end
+
+fclose(fid);
+end